@@ -0,0 +1,201 @@
+// Evaluating expression trees.
+//
+// The "recursive" column evaluates a tree with a visitor that visits the
+// children of a node recursively, the "fold" column uses juice::fold, and
+// the "workspace" column uses fold with a workspace that is kept between
+// evaluations, so that its stacks are not allocated again.
+//
+// fold keeps its own stack, so it also evaluates chains that are too deep
+// for the recursive visitor, which runs out of stack.
+
+#include <juice/fold.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+  struct Apply;
+
+  typedef juice::variant<int, juice::recursive_wrapper<Apply>> Expr;
+
+  struct Apply
+  {
+    char op;
+    std::vector<Expr> args;
+  };
+
+  template <typename F>
+  void
+  for_each_child(const Apply& a, F&& f)
+  {
+    for (auto& arg : a.args)
+    {
+      f(arg);
+    }
+  }
+
+  long
+  apply(char op, long a, long b)
+  {
+    return op == '+' ? a + b : (a * b) % 1000003;
+  }
+
+  struct Recursive
+  {
+    long
+    operator()(int i) const
+    {
+      return i;
+    }
+
+    long
+    operator()(const Apply& a) const
+    {
+      long result = a.op == '+' ? 0 : 1;
+      for (auto& arg : a.args)
+      {
+        result = apply(a.op, result, juice::visit(*this, arg));
+      }
+      return result;
+    }
+  };
+
+  struct Evaluate
+  {
+    long
+    operator()(int i) const
+    {
+      return i;
+    }
+
+    long
+    operator()(const Apply& a, juice::fold_results<long> args) const
+    {
+      long result = a.op == '+' ? 0 : 1;
+      for (long i : args)
+      {
+        result = apply(a.op, result, i);
+      }
+      return result;
+    }
+  };
+
+  Expr
+  balanced(int depth, int& next)
+  {
+    if (depth == 0)
+    {
+      return next++ % 10;
+    }
+
+    Apply a{depth % 2 == 0 ? '+' : '*', {}};
+    for (int i = 0; i != 3; ++i)
+    {
+      a.args.push_back(balanced(depth - 1, next));
+    }
+    return a;
+  }
+
+  //a chain of nodes, each with a leaf and the rest of the chain
+  Expr
+  deep(int depth)
+  {
+    Expr e = 1;
+    for (int i = 0; i != depth; ++i)
+    {
+      Apply a{'+', {}};
+      a.args.reserve(2);
+      a.args.push_back(i % 10);
+      a.args.push_back(std::move(e));
+      e = std::move(a);
+    }
+    return e;
+  }
+
+  template <typename F>
+  double
+  time_ms(size_t iterations, long& total, F f)
+  {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i != iterations; ++i)
+    {
+      total += f();
+    }
+
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+  }
+
+  void
+  run(const char* name, const Expr& e, size_t iterations)
+  {
+    long total = 0;
+    juice::fold_workspace<Expr, long> ws;
+
+    //the three take turns, and the best round of each is kept, so that
+    //other work on the machine counts for less
+    double recursive = 0;
+    double fold = 0;
+    double workspace = 0;
+    for (int round = 0; round != 7; ++round)
+    {
+      double r = time_ms(iterations, total, [&e] {
+        return juice::visit(Recursive(), e);
+      });
+      double f = time_ms(iterations, total, [&e] {
+        return juice::fold(e, Evaluate());
+      });
+      double w = time_ms(iterations, total, [&e, &ws] {
+        return juice::fold(e, Evaluate(), ws);
+      });
+
+      recursive = round == 0 ? r : std::min(recursive, r);
+      fold = round == 0 ? f : std::min(fold, f);
+      workspace = round == 0 ? w : std::min(workspace, w);
+    }
+
+    std::printf("%-24s %10.3f ms %10.3f ms %10.3f ms\n", name, recursive,
+      fold, workspace);
+
+    //so that the evaluations are not optimised away
+    if (total == 42)
+    {
+      std::printf("\n");
+    }
+  }
+
+  //destroys a deep chain without recursing through its nodes
+  void
+  tear_down(Expr& e)
+  {
+    while (e.index() == 1)
+    {
+      Expr next = std::move(juice::get<Apply>(e).args.back());
+      e = std::move(next);
+    }
+  }
+}
+
+int
+main()
+{
+  std::printf("%-24s %13s %13s %13s\n", "", "recursive", "fold",
+    "workspace");
+
+  int next = 0;
+  Expr wide = balanced(12, next);
+  run("3^12 leaves", wide, 10);
+
+  Expr small = balanced(8, next);
+  run("3^8 leaves", small, 1000);
+
+  Expr chain = deep(5000);
+  run("chain of 5000", chain, 100);
+  tear_down(chain);
+
+  return 0;
+}
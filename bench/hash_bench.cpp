@@ -0,0 +1,109 @@
+// Hashing variants.
+//
+// The "typeid" column is the hash that was used before, which combined the
+// hash of a std::type_index of the alternative with the hash of its value.
+// The "mix" column uses mix_hasher for the values instead of std::hash.
+
+#include <juice/variant.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <typeindex>
+#include <vector>
+
+namespace
+{
+  const size_t iterations = 20;
+
+  struct typeid_hash
+  {
+    static
+    size_t
+    hash_combine(size_t seed, size_t combine)
+    {
+      return seed ^ (combine + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+    }
+
+    struct visitor
+    {
+      template <typename T>
+      size_t
+      operator()(const T& t)
+      {
+        std::type_index ti(typeid(t));
+        size_t h = std::hash<std::type_index>()(ti);
+        return hash_combine(h, std::hash<T>()(t));
+      }
+    };
+
+    template <typename... Types>
+    size_t
+    operator()(const juice::variant<Types...>& v) const
+    {
+      return v.template apply_visitor<juice::MPL::true_>(visitor());
+    }
+  };
+
+  template <typename Hash, typename V>
+  double
+  time_hash(const std::vector<V>& values)
+  {
+    Hash hash;
+    size_t total = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i != iterations; ++i)
+    {
+      for (const auto& v : values)
+      {
+        total += hash(v);
+      }
+    }
+
+    std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    //so that the hashes are not optimised away
+    if (total == 42)
+    {
+      std::printf("\n");
+    }
+
+    return elapsed.count() / (iterations * values.size());
+  }
+
+  template <typename V>
+  void
+  run(const char* name, const std::vector<V>& values)
+  {
+    std::printf("%-24s %10.2f ns %10.2f ns %10.2f ns\n", name,
+      time_hash<std::hash<V>>(values),
+      time_hash<juice::basic_variant_hash<juice::mix_hasher>>(values),
+      time_hash<typeid_hash>(values));
+  }
+}
+
+int
+main()
+{
+  std::printf("%-24s %13s %13s %13s\n", "", "std::hash", "mix", "typeid");
+
+  typedef juice::variant<int, double> Numbers;
+  std::vector<Numbers> numbers;
+  for (int i = 0; i != 100000; ++i)
+  {
+    numbers.push_back(i % 2 == 0 ? Numbers(i) : Numbers(i * 0.5));
+  }
+  run("int, double", numbers);
+
+  typedef juice::variant<long, std::string> Keys;
+  std::vector<Keys> keys;
+  for (long i = 0; i != 100000; ++i)
+  {
+    keys.push_back(i % 2 == 0 ? Keys(i) : Keys("key " + std::to_string(i)));
+  }
+  run("long, std::string", keys);
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+// Maps keyed by variant<int64_t, std::string>.
+//
+// The "unordered_map" column uses std::unordered_map and the "hash_map"
+// column juice::variant_hash_map, both with variant_hash. Half of the keys
+// are integers and half are strings, of which half are too long to be stored
+// in the string itself. "insert" builds a map of every key without reserving,
+// "find" looks up every key in a shuffled order, so that entries allocated
+// one after another are not also found one after another, and "miss" looks
+// up keys that are not there.
+
+#include <juice/variant_hash_map.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+  typedef juice::variant<std::int64_t, std::string> Key;
+
+  typedef std::unordered_map<Key, long, juice::variant_hash<Key>,
+    juice::variant_equal<Key>> std_map;
+  typedef juice::variant_hash_map<Key, long> juice_map;
+
+  std::vector<Key>
+  make_keys(size_t n, std::int64_t first)
+  {
+    std::vector<Key> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i != n; ++i)
+    {
+      std::int64_t k = first + static_cast<std::int64_t>(i);
+      switch (i % 4)
+      {
+        case 0:
+        case 1:
+        keys.push_back(k * 7919);
+        break;
+
+        case 2:
+        keys.push_back("k" + std::to_string(k));
+        break;
+
+        default:
+        keys.push_back("a much longer key " + std::to_string(k));
+        break;
+      }
+    }
+    return keys;
+  }
+
+  template <typename F>
+  double
+  time_ms(long& total, F f)
+  {
+    auto start = std::chrono::steady_clock::now();
+    total += f();
+    std::chrono::duration<double, std::milli> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+  }
+
+  template <typename Map>
+  long
+  insert(const std::vector<Key>& keys)
+  {
+    Map m;
+    long i = 0;
+    for (const auto& k : keys)
+    {
+      m[k] = i++;
+    }
+    return static_cast<long>(m.size());
+  }
+
+  template <typename Map>
+  long
+  find(const Map& m, const std::vector<Key>& keys)
+  {
+    long total = 0;
+    for (const auto& k : keys)
+    {
+      auto it = m.find(k);
+      if (it != m.end())
+      {
+        total += it->second;
+      }
+    }
+    return total;
+  }
+
+  template <typename Map>
+  Map
+  build(const std::vector<Key>& keys)
+  {
+    Map m;
+    long i = 0;
+    for (const auto& k : keys)
+    {
+      m[k] = i++;
+    }
+    return m;
+  }
+
+  //the two maps take turns, and the best of seven rounds of each is kept,
+  //so that other work on the machine counts for less
+  template <typename F, typename G>
+  void
+  run(const char* name, long& total, F f, G g)
+  {
+    double a = 0;
+    double b = 0;
+    for (int round = 0; round != 7; ++round)
+    {
+      double x = time_ms(total, f);
+      double y = time_ms(total, g);
+      a = round == 0 ? x : std::min(a, x);
+      b = round == 0 ? y : std::min(b, y);
+    }
+
+    std::printf("%-24s %10.3f ms %10.3f ms\n", name, a, b);
+  }
+}
+
+int
+main()
+{
+  const size_t n = 200000;
+  std::vector<Key> keys = make_keys(n, 0);
+  std::vector<Key> missing = make_keys(n, static_cast<std::int64_t>(n));
+  std::vector<Key> shuffled = keys;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+
+  std::printf("%-24s %13s %13s\n", "", "unordered_map", "hash_map");
+
+  long total = 0;
+  run("insert", total,
+    [&keys] { return insert<std_map>(keys); },
+    [&keys] { return insert<juice_map>(keys); });
+
+  std_map s = build<std_map>(keys);
+  juice_map j = build<juice_map>(keys);
+
+  run("find", total,
+    [&] { return find(s, shuffled); },
+    [&] { return find(j, shuffled); });
+  run("miss", total,
+    [&] { return find(s, missing); },
+    [&] { return find(j, missing); });
+
+  //so that the lookups are not optimised away
+  if (total == 42)
+  {
+    std::printf("\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Sorting vectors of variants.
+//
+// "std::sort" sorts with operator<, which finds the alternatives of both
+// variants for every comparison. "juice::sort" partitions by index first and
+// then sorts each partition with a comparison of the one alternative that it
+// holds, and "parallel_sort" sorts the partitions at the same time.
+
+#include <juice/sort.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const size_t iterations = 5;
+
+  template <typename Sort, typename V>
+  double
+  time_sort(const std::vector<V>& values, Sort sort)
+  {
+    double total = 0;
+    for (size_t i = 0; i != iterations; ++i)
+    {
+      std::vector<V> copy = values;
+      auto start = std::chrono::steady_clock::now();
+
+      sort(copy);
+
+      std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+      total += elapsed.count();
+
+      if (!std::is_sorted(copy.begin(), copy.end()))
+      {
+        std::printf("not sorted\n");
+      }
+    }
+
+    return total / iterations;
+  }
+
+  template <typename V>
+  void
+  run(const char* name, const std::vector<V>& values)
+  {
+    std::printf("%-24s %10.2f ms %10.2f ms %10.2f ms\n", name,
+      time_sort(values, [] (std::vector<V>& v) {
+        std::sort(v.begin(), v.end());
+      }),
+      time_sort(values, [] (std::vector<V>& v) { juice::sort(v); }),
+      time_sort(values, [] (std::vector<V>& v) { juice::parallel_sort(v); }));
+  }
+}
+
+int
+main()
+{
+  std::printf("%-24s %13s %13s %13s\n", "", "std::sort", "juice::sort",
+    "parallel_sort");
+
+  std::mt19937 random(1);
+
+  typedef juice::variant<int, double, long> Numbers;
+  std::vector<Numbers> numbers;
+  for (int i = 0; i != 1000000; ++i)
+  {
+    int r = static_cast<int>(random());
+    switch (i % 3)
+    {
+      case 0:
+      numbers.push_back(r);
+      break;
+      case 1:
+      numbers.push_back(r * 0.5);
+      break;
+      default:
+      numbers.push_back(static_cast<long>(r));
+      break;
+    }
+  }
+  run("int, double, long", numbers);
+
+  typedef juice::variant<long, std::string> Keys;
+  std::vector<Keys> keys;
+  for (long i = 0; i != 200000; ++i)
+  {
+    long r = random();
+    keys.push_back(i % 2 == 0 ? Keys(r) : Keys("key " + std::to_string(r)));
+  }
+  run("long, std::string", keys);
+
+  return 0;
+}
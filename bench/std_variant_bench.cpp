@@ -0,0 +1,91 @@
+// Converting between juice::variant and std::variant at a module boundary.
+//
+// Each case converts a variant to a std::variant and back. The "visit"
+// column does it the way it was done before to_std and from_std, by
+// visiting the value and constructing the other variant from a copy of it.
+
+#include <juice/std_variant.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+  const size_t iterations = 2000000;
+
+  template <typename V>
+  struct copy_to_std
+  {
+    template <typename T>
+    juice::std_variant_t<V>
+    operator()(const T& t) const
+    {
+      return juice::std_variant_t<V>(t);
+    }
+  };
+
+  template <typename V>
+  struct copy_from_std
+  {
+    template <typename T>
+    V
+    operator()(const T& t) const
+    {
+      return V(t);
+    }
+  };
+
+  template <typename V>
+  double
+  time_convert(const V& value, bool visiting)
+  {
+    V v(value);
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i != iterations; ++i)
+    {
+      if (visiting)
+      {
+        auto s = juice::visit(copy_to_std<V>(), v);
+        v = std::visit(copy_from_std<V>(), s);
+      }
+      else
+      {
+        auto s = juice::to_std(std::move(v));
+        v = juice::from_std<V>(std::move(s));
+      }
+    }
+
+    std::chrono::duration<double, std::nano> elapsed =
+      std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+  }
+
+  template <typename V>
+  void
+  run(const char* name, const V& v)
+  {
+    std::printf("%-24s %10.1f ns %10.1f ns\n", name,
+      time_convert(v, false), time_convert(v, true));
+  }
+}
+
+int
+main()
+{
+  std::printf("%-24s %13s %13s\n", "", "to_std", "visit");
+
+  typedef juice::variant<int, double> Numbers;
+  run("int, double", Numbers(1.0));
+
+  typedef juice::variant<int, std::string> Named;
+  run("int, std::string", Named(
+    std::string("a string that does not fit in the buffer")));
+
+  typedef juice::variant<double, std::vector<int>> Values;
+  run("double, std::vector", Values(std::vector<int>(16, 1)));
+
+  return 0;
+}
@@ -0,0 +1,275 @@
+// Arena allocated recursive trees for juice::variant.
+//
+// arena_wrapper<T> can be used in place of recursive_wrapper<T>. Its nodes
+// are allocated from the tree_arena bound to the current thread with
+// tree_arena::scope, and are never destroyed one at a time. Instead all of
+// the memory of the arena is released at once when it is reset or goes
+// away, which only touches the blocks of the arena and not the nodes.
+//
+// Since an arena_wrapper has no destructor, a variant whose other
+// alternatives are trivially destructible is trivially destructible too, and
+// destroying a tree of them costs nothing. Only nodes that are trivially
+// destructible can be put in an arena, so nothing that owns resources can be
+// lost this way. Trees that do need destructors can use deferred_destroy.
+
+#ifndef JUICE_ARENA_HPP_INCLUDED
+#define JUICE_ARENA_HPP_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "thread_binding.hpp"
+#include "variant.hpp"
+
+namespace juice
+{
+  class tree_arena : public detail::thread_bound<tree_arena>
+  {
+    public:
+
+    explicit
+    tree_arena(size_t block_size = 64 * 1024)
+    : m_block_size(block_size)
+    , m_next(nullptr)
+    , m_end(nullptr)
+    {
+    }
+
+    tree_arena(const tree_arena&) = delete;
+
+    tree_arena&
+    operator=(const tree_arena&) = delete;
+
+    template <typename T, typename... Args>
+    T*
+    construct(Args&&... args)
+    {
+      static_assert(std::is_trivially_destructible<T>::value,
+        "the destructor of an arena node would never be called");
+
+      void* memory = allocate(sizeof(T), alignof(T));
+      return new (memory) T(std::forward<Args>(args)...);
+    }
+
+    //releases every node, but keeps the first block to allocate from again
+    void
+    reset()
+    {
+      if (m_blocks.empty())
+      {
+        return;
+      }
+
+      m_blocks.resize(1);
+      m_next = m_blocks.front().memory.get();
+      m_end = m_next + m_blocks.front().size;
+    }
+
+    //the number of bytes held by the arena
+    size_t
+    capacity() const
+    {
+      size_t total = 0;
+      for (auto& b : m_blocks)
+      {
+        total += b.size;
+      }
+      return total;
+    }
+
+    static
+    tree_arena&
+    current()
+    {
+      assert(bound() != nullptr && "no tree_arena is bound to this thread");
+      return *bound();
+    }
+
+    private:
+
+    struct block
+    {
+      std::unique_ptr<unsigned char[]> memory;
+      size_t size;
+    };
+
+    void*
+    allocate(size_t size, size_t align)
+    {
+      void* p = m_next;
+      size_t space = m_end - m_next;
+      if (m_next == nullptr || std::align(align, size, p, space) == nullptr)
+      {
+        size_t block_size = std::max(m_block_size, size + align);
+        m_blocks.push_back(block{
+          std::unique_ptr<unsigned char[]>(new unsigned char[block_size]),
+          block_size});
+
+        p = m_blocks.back().memory.get();
+        space = block_size;
+        std::align(align, size, p, space);
+      }
+
+      m_next = static_cast<unsigned char*>(p) + size;
+      m_end = m_next + (space - size);
+      return p;
+    }
+
+    size_t m_block_size;
+    std::vector<block> m_blocks;
+    unsigned char* m_next;
+    unsigned char* m_end;
+  };
+
+  template <typename T>
+  class arena_wrapper
+  {
+    public:
+
+    template
+    <
+      typename U,
+      typename Dummy =
+        typename std::enable_if<std::is_convertible<U, T>::value, U>::type
+    >
+    arena_wrapper(U&& u)
+    : m_t(tree_arena::current().template construct<T>(std::forward<U>(u)))
+    {
+    }
+
+    arena_wrapper(const arena_wrapper& rhs)
+    : m_t(tree_arena::current().template construct<T>(rhs.get()))
+    {
+    }
+
+    arena_wrapper(arena_wrapper&& rhs) noexcept
+    : m_t(rhs.m_t)
+    {
+      rhs.m_t = nullptr;
+    }
+
+    arena_wrapper&
+    operator=(const arena_wrapper& rhs)
+    {
+      assign(rhs.get());
+      return *this;
+    }
+
+    arena_wrapper&
+    operator=(arena_wrapper&& rhs) noexcept
+    {
+      //the old node stays in the arena until the arena goes
+      if (this != &rhs)
+      {
+        m_t = rhs.m_t;
+        rhs.m_t = nullptr;
+      }
+      return *this;
+    }
+
+    arena_wrapper&
+    operator=(const T& t)
+    {
+      assign(t);
+      return *this;
+    }
+
+    arena_wrapper&
+    operator=(T&& t)
+    {
+      assign(std::move(t));
+      return *this;
+    }
+
+    //a wrapper that has been moved from only equals another one
+    bool
+    operator==(const arena_wrapper& rhs) const
+    {
+      if (m_t == rhs.m_t)
+      {
+        return true;
+      }
+      else if (m_t == nullptr || rhs.m_t == nullptr)
+      {
+        return false;
+      }
+
+      return *m_t == *rhs.m_t;
+    }
+
+    T& get() { return *m_t; }
+    const T& get() const { return *m_t; }
+
+    private:
+    T* m_t;
+
+    //a wrapper that has been moved from has no node, and gets a new one
+    template <typename U>
+    void
+    assign(U&& u)
+    {
+      if (m_t == nullptr)
+      {
+        m_t = tree_arena::current().template construct<T>(
+          std::forward<U>(u));
+      }
+      else
+      {
+        *m_t = std::forward<U>(u);
+      }
+    }
+  };
+
+  template <typename T>
+  struct is_recursive_wrapper<arena_wrapper<T>>
+    : public std::true_type {};
+
+  template <typename T>
+  struct is_trivially_relocatable<arena_wrapper<T>>
+    : public std::true_type {};
+
+  template <typename T>
+  struct unwrapped_type<arena_wrapper<T>>
+  {
+    typedef T type;
+  };
+
+  template <typename T>
+  const T&
+  recursive_unwrap(const arena_wrapper<T>& a)
+  {
+    return a.get();
+  }
+
+  template <typename T>
+  T&
+  recursive_unwrap(arena_wrapper<T>& a)
+  {
+    return a.get();
+  }
+
+  template <size_t N, typename T, typename... Types>
+  struct tuple_find_helper<N, T, arena_wrapper<T>, Types...> :
+    public std::integral_constant<std::size_t, N>
+  {
+  };
+}
+
+namespace std
+{
+  template <typename T>
+  struct hash<juice::arena_wrapper<T>>
+  {
+    size_t
+    operator()(const juice::arena_wrapper<T>& a) const
+    {
+      return hash<T>()(a.get());
+    }
+  };
+}
+
+#endif
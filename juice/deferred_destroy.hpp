@@ -0,0 +1,147 @@
+// Destroying values on a background thread.
+//
+// deferred_destroy moves a value, usually a large tree of variants, to a
+// reclamation thread that destroys it later. Moving a tree only moves the
+// pointers at its root, so the caller pays for one allocation and a lock
+// instead of freeing every node.
+//
+// The thread is started the first time something is deferred, and stops
+// after destroying whatever is left when the program exits. Nothing should
+// be deferred from the destructor of a static object.
+
+#ifndef JUICE_DEFERRED_DESTROY_HPP_INCLUDED
+#define JUICE_DEFERRED_DESTROY_HPP_INCLUDED
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace juice
+{
+  class reclaimer
+  {
+    public:
+
+    static
+    reclaimer&
+    instance()
+    {
+      static reclaimer r;
+      return r;
+    }
+
+    template <typename T>
+    void
+    defer(T&& t)
+    {
+      std::unique_ptr<garbage> g(new holder<std::decay_t<T>>(
+        std::forward<T>(t)));
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_queue.push_back(std::move(g));
+      ++m_pending;
+      m_wake.notify_one();
+    }
+
+    //waits until everything deferred so far has been destroyed
+    void
+    drain()
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_drained.wait(lock, [this] { return m_pending == 0; });
+    }
+
+    ~reclaimer()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_wake.notify_one();
+      }
+      m_thread.join();
+    }
+
+    reclaimer(const reclaimer&) = delete;
+
+    reclaimer&
+    operator=(const reclaimer&) = delete;
+
+    private:
+
+    struct garbage
+    {
+      virtual ~garbage() = default;
+    };
+
+    template <typename T>
+    struct holder : public garbage
+    {
+      holder(T&& t)
+      : value(std::move(t))
+      {
+      }
+
+      T value;
+    };
+
+    reclaimer()
+    : m_pending(0)
+    , m_stop(false)
+    , m_thread([this] { run(); })
+    {
+    }
+
+    void
+    run()
+    {
+      std::vector<std::unique_ptr<garbage>> batch;
+      std::unique_lock<std::mutex> lock(m_mutex);
+
+      while (true)
+      {
+        m_wake.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_queue.empty())
+        {
+          return;
+        }
+
+        //everything queued is destroyed without holding the lock
+        batch.swap(m_queue);
+        lock.unlock();
+        size_t destroyed = batch.size();
+        batch.clear();
+        lock.lock();
+
+        m_pending -= destroyed;
+        if (m_pending == 0)
+        {
+          m_drained.notify_all();
+        }
+      }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_drained;
+    std::vector<std::unique_ptr<garbage>> m_queue;
+    size_t m_pending;
+    bool m_stop;
+    std::thread m_thread;
+  };
+
+  //hands the value to the reclamation thread, it has to be an rvalue
+  template <typename T>
+  void
+  deferred_destroy(T&& t)
+  {
+    static_assert(!std::is_lvalue_reference<T>::value,
+      "use deferred_destroy(std::move(value))");
+    reclaimer::instance().defer(std::move(t));
+  }
+}
+
+#endif
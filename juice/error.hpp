@@ -0,0 +1,80 @@
+// Reporting errors with or without exceptions.
+//
+// Errors such as asking a variant for an alternative that it doesn't hold
+// are thrown as exceptions. When JUICE_NO_EXCEPTIONS is defined, for code
+// that is built with -fno-exceptions, they are passed to the error handler
+// instead. The handler is given the what() of the exception that would have
+// been thrown, and must not return. The default handler prints the error and
+// aborts, and if a handler does return the program is aborted anyway.
+//
+// JUICE_TRY, JUICE_CATCH_ALL and JUICE_RETHROW are used instead of try,
+// catch (...) and throw to clean up when something throws. Without
+// exceptions they are the two branches of one if statement, so that the
+// cleanup is never run and, like try and catch, they make one statement
+// that an else after them can't bind to.
+
+#ifndef JUICE_ERROR_HPP_INCLUDED
+#define JUICE_ERROR_HPP_INCLUDED
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef JUICE_NO_EXCEPTIONS
+#define JUICE_TRY if (true)
+#define JUICE_CATCH_ALL else
+#define JUICE_RETHROW std::abort()
+#else
+#define JUICE_TRY try
+#define JUICE_CATCH_ALL catch (...)
+#define JUICE_RETHROW throw
+#endif
+
+namespace juice
+{
+  typedef void (*error_handler)(const char* what);
+
+  namespace detail
+  {
+    inline
+    void
+    default_error_handler(const char* what)
+    {
+      std::fprintf(stderr, "juice: %s\n", what);
+      std::abort();
+    }
+
+    inline
+    std::atomic<error_handler>&
+    current_error_handler()
+    {
+      static std::atomic<error_handler> handler(&default_error_handler);
+      return handler;
+    }
+
+    //throws e, or hands it to the error handler without exceptions
+    template <typename E>
+    [[noreturn]]
+    void
+    raise(const E& e)
+    {
+#ifdef JUICE_NO_EXCEPTIONS
+      current_error_handler().load()(e.what());
+      std::abort();
+#else
+      throw e;
+#endif
+    }
+  }
+
+  //sets the handler used when JUICE_NO_EXCEPTIONS is defined, and returns
+  //the previous one
+  inline
+  error_handler
+  set_error_handler(error_handler handler)
+  {
+    return detail::current_error_handler().exchange(handler);
+  }
+}
+
+#endif
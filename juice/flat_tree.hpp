@@ -0,0 +1,377 @@
+// Recursive variant trees flattened into contiguous arrays.
+//
+// flat_tree<Variant> stores a tree in pre-order in three parallel arrays:
+// the index of each value, the value itself with any recursive wrapper
+// removed, and the size of the subtree rooted at each value. The children of
+// the node at i start at i + 1, and the next sibling of any value at i is at
+// i + subtree_size(i), so a tree can be walked and folded without chasing
+// pointers.
+//
+// The nodes kept in the value array keep their containers of child
+// variants, so that unflatten can fill them in again, but the children
+// themselves are moved out and left valueless when the tree is flattened.
+// Moving out a recursive_wrapper child only moves its pointer, so flattening
+// doesn't allocate anything but the arrays. A tree with a valueless value
+// can't be flattened, and raises bad_variant_access.
+//
+// Building a flat tree and turning it back into a tree both need a
+// for_each_child that can modify the children of a node, as well as the
+// const version that fold uses.
+
+#ifndef JUICE_FLAT_TREE_HPP_INCLUDED
+#define JUICE_FLAT_TREE_HPP_INCLUDED
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "fold.hpp"
+
+namespace juice
+{
+  template <typename Variant>
+  class flat_tree;
+
+  template <typename... Types>
+  class flat_tree<variant<Types...>>
+  {
+    public:
+
+    typedef variant<Types...> tree_type;
+
+    //the value stored for each position, which is the tree type without
+    //recursive wrappers
+    typedef variant<std::remove_const_t<unwrapped_type_t<Types>>...>
+      value_type;
+
+    static_assert(sizeof...(Types) <= 256, "too many types for a flat tree");
+
+    //an empty flat tree, which can't be folded or unflattened
+    flat_tree() = default;
+
+    //flattens the tree, which is moved from
+    explicit
+    flat_tree(tree_type tree)
+    {
+      std::vector<tree_type> pending;
+      pending.push_back(std::move(tree));
+
+      //the nodes whose subtrees are not finished yet, and how many of their
+      //children are still to come
+      std::vector<std::pair<size_t, size_t>> open;
+
+      while (!pending.empty())
+      {
+        tree_type t = std::move(pending.back());
+        pending.pop_back();
+
+        size_t position = size();
+        size_t first = pending.size();
+
+        require_value(t);
+        m_tags.push_back(static_cast<unsigned char>(t.index()));
+        m_sizes.push_back(1);
+        flatten_table()[t.index()](*this, t, pending);
+
+        size_t children = pending.size() - first;
+        std::reverse(pending.begin() + first, pending.end());
+
+        if (children != 0)
+        {
+          open.emplace_back(position, children);
+          continue;
+        }
+
+        //a subtree is finished, which might finish its ancestors
+        while (!open.empty() && --open.back().second == 0)
+        {
+          size_t node = open.back().first;
+          m_sizes[node] = static_cast<std::uint32_t>(size() - node);
+          open.pop_back();
+        }
+      }
+    }
+
+    size_t size() const { return m_tags.size(); }
+
+    //the index of the value at i in tree_type
+    size_t index(size_t i) const { return m_tags[i]; }
+
+    size_t subtree_size(size_t i) const { return m_sizes[i]; }
+
+    size_t next_sibling(size_t i) const { return i + m_sizes[i]; }
+
+    const value_type& value(size_t i) const { return m_values[i]; }
+
+    template <typename Visitor>
+    decltype(auto)
+    visit(Visitor&& visitor, size_t i) const
+    {
+      return juice::visit(std::forward<Visitor>(visitor), m_values[i]);
+    }
+
+    //the same as juice::fold on the original tree, but the values are
+    //visited from the end of the arrays to the front
+    template <typename Algebra>
+    auto
+    fold(Algebra&& algebra) const
+    {
+      typedef typename detail::fold_result<
+        std::remove_reference_t<Algebra>, tree_type>::type R;
+
+      assert(size() != 0 && "an empty flat_tree has no tree to fold");
+
+      std::vector<R> results;
+      for (size_t i = size(); i-- != 0;)
+      {
+        fold_table<Algebra, R>()[m_tags[i]](*this, algebra, i, results);
+      }
+
+      return std::move(results.back());
+    }
+
+    //rebuilds the tree that was flattened
+    tree_type
+    unflatten() const
+    {
+      assert(size() != 0 && "an empty flat_tree has no tree to unflatten");
+
+      std::vector<tree_type> built;
+      for (size_t i = size(); i-- != 0;)
+      {
+        unflatten_table()[m_tags[i]](*this, i, built);
+      }
+
+      return std::move(built.back());
+    }
+
+    private:
+
+    std::vector<unsigned char> m_tags;
+    std::vector<value_type> m_values;
+    std::vector<std::uint32_t> m_sizes;
+
+    template <size_t I>
+    using alternative = std::tuple_element_t<I, tree_type>;
+
+    template <size_t I>
+    using unwrapped = std::remove_const_t<unwrapped_type_t<alternative<I>>>;
+
+    typedef void (*flattener)(flat_tree&, tree_type&,
+      std::vector<tree_type>&);
+
+    template <size_t I>
+    static
+    void
+    flatten(flat_tree& self, tree_type& t, std::vector<tree_type>& pending)
+    {
+      flatten<I>(self, t, pending, is_recursive_wrapper<alternative<I>>());
+    }
+
+    template <size_t I>
+    static
+    void
+    flatten(flat_tree& self, tree_type& t, std::vector<tree_type>&,
+      std::false_type)
+    {
+      self.m_values.emplace_back(emplaced_index<I>,
+        std::move(t.template get<I>()));
+    }
+
+    template <size_t I>
+    static
+    void
+    flatten(flat_tree& self, tree_type& t, std::vector<tree_type>& pending,
+      std::true_type)
+    {
+      auto& wrapper = t.template get<I>();
+      unwrapped<I> node(std::move(recursive_unwrap(wrapper)));
+
+      for_each_child(node, [&pending] (tree_type& child) {
+        require_value(child);
+        take_table()[child.index()](child, pending);
+      });
+
+      self.m_values.emplace_back(emplaced_index<I>, std::move(node));
+    }
+
+    //the flattening tables are indexed by the index of a value, which a
+    //valueless value doesn't have
+    static
+    void
+    require_value(const tree_type& t)
+    {
+      if (t.valueless_by_exception())
+      {
+        detail::raise(bad_variant_access("Can't flatten a valueless tree"));
+      }
+    }
+
+    typedef void (*taker)(tree_type&, std::vector<tree_type>&);
+
+    //moves child onto pending and leaves it valueless
+    template <size_t I>
+    static
+    void
+    take(tree_type& child, std::vector<tree_type>& pending)
+    {
+      pending.emplace_back(emplaced_index<I>, child.template extract<I>());
+    }
+
+    template <size_t... I>
+    static
+    const taker*
+    take_table(std::index_sequence<I...>)
+    {
+      static const taker table[] = {&take<I>...};
+      return table;
+    }
+
+    static
+    const taker*
+    take_table()
+    {
+      return take_table(std::index_sequence_for<Types...>());
+    }
+
+    template <size_t... I>
+    static
+    const flattener*
+    flatten_table(std::index_sequence<I...>)
+    {
+      static const flattener table[] = {&flatten<I>...};
+      return table;
+    }
+
+    static
+    const flattener*
+    flatten_table()
+    {
+      return flatten_table(std::index_sequence_for<Types...>());
+    }
+
+    template <typename Algebra, typename R>
+    using folder = void (*)(const flat_tree&, Algebra&, size_t,
+      std::vector<R>&);
+
+    template <size_t I, typename Algebra, typename R>
+    static
+    void
+    fold_at(const flat_tree& self, Algebra& algebra, size_t i,
+      std::vector<R>& results)
+    {
+      fold_at<I>(self, algebra, i, results,
+        is_recursive_wrapper<alternative<I>>());
+    }
+
+    template <size_t I, typename Algebra, typename R>
+    static
+    void
+    fold_at(const flat_tree& self, Algebra& algebra, size_t i,
+      std::vector<R>& results, std::false_type)
+    {
+      results.push_back(algebra(get<I>(self.m_values[i])));
+    }
+
+    template <size_t I, typename Algebra, typename R>
+    static
+    void
+    fold_at(const flat_tree& self, Algebra& algebra, size_t i,
+      std::vector<R>& results, std::true_type)
+    {
+      size_t children = 0;
+      for (size_t c = i + 1; c != self.next_sibling(i);
+        c = self.next_sibling(c))
+      {
+        ++children;
+      }
+
+      //the last child was folded first, so the results are backwards
+      auto first = results.end() - children;
+      std::reverse(first, results.end());
+
+      R r = algebra(get<I>(self.m_values[i]),
+        fold_results<R>(results.data() + (first - results.begin()),
+          children));
+
+      results.erase(first, results.end());
+      results.push_back(std::move(r));
+    }
+
+    template <typename Algebra, typename R, size_t... I>
+    static
+    const folder<Algebra, R>*
+    fold_table(std::index_sequence<I...>)
+    {
+      static const folder<Algebra, R> table[] = {&fold_at<I, Algebra, R>...};
+      return table;
+    }
+
+    template <typename Algebra, typename R>
+    static
+    const folder<std::remove_reference_t<Algebra>, R>*
+    fold_table()
+    {
+      return fold_table<std::remove_reference_t<Algebra>, R>(
+        std::index_sequence_for<Types...>());
+    }
+
+    typedef void (*unflattener)(const flat_tree&, size_t,
+      std::vector<tree_type>&);
+
+    template <size_t I>
+    static
+    void
+    unflatten_at(const flat_tree& self, size_t i,
+      std::vector<tree_type>& built)
+    {
+      unflatten_at<I>(self, i, built, is_recursive_wrapper<alternative<I>>());
+    }
+
+    template <size_t I>
+    static
+    void
+    unflatten_at(const flat_tree& self, size_t i,
+      std::vector<tree_type>& built, std::false_type)
+    {
+      built.emplace_back(emplaced_index<I>, get<I>(self.m_values[i]));
+    }
+
+    template <size_t I>
+    static
+    void
+    unflatten_at(const flat_tree& self, size_t i,
+      std::vector<tree_type>& built, std::true_type)
+    {
+      unwrapped<I> node(get<I>(self.m_values[i]));
+
+      //the children were built backwards, so the first child is on top
+      for_each_child(node, [&built] (tree_type& child) {
+        child = std::move(built.back());
+        built.pop_back();
+      });
+
+      built.emplace_back(emplaced_index<I>, std::move(node));
+    }
+
+    template <size_t... I>
+    static
+    const unflattener*
+    unflatten_table(std::index_sequence<I...>)
+    {
+      static const unflattener table[] = {&unflatten_at<I>...};
+      return table;
+    }
+
+    static
+    const unflattener*
+    unflatten_table()
+    {
+      return unflatten_table(std::index_sequence_for<Types...>());
+    }
+  };
+}
+
+#endif
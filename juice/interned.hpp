@@ -0,0 +1,224 @@
+// Hash consed recursive nodes for juice::variant.
+//
+// interned<T> can be used in place of recursive_wrapper<T> for trees that are
+// not mutated once they are built. Every node is looked up in an
+// intern_table when it is created, so structurally identical subtrees share
+// one canonical node. Comparing or hashing two interned nodes is then a
+// pointer comparison or a pointer hash, no matter how deep the subtrees are.
+//
+// The table hashes and compares a node with std::hash<T> and operator== by
+// default. When the children of T are variants holding interned<T>, those
+// only look at the immediate children, so interning a node costs time
+// proportional to its number of children.
+//
+// Nodes live as long as their table, and the global table of a type is
+// deliberately leaked, so it is never destroyed. Nodes from different tables
+// never compare equal. The tables can be used from multiple threads, and
+// interned nodes can be read from any thread because they are never
+// modified.
+
+#ifndef JUICE_INTERNED_HPP_INCLUDED
+#define JUICE_INTERNED_HPP_INCLUDED
+
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <unordered_set>
+
+#include "variant.hpp"
+
+namespace juice
+{
+  template
+  <
+    typename T,
+    typename Hash = std::hash<T>,
+    typename Equal = std::equal_to<T>
+  >
+  class intern_table
+  {
+    public:
+
+    intern_table() = default;
+
+    intern_table(const intern_table&) = delete;
+
+    intern_table&
+    operator=(const intern_table&) = delete;
+
+    static
+    intern_table&
+    global()
+    {
+      //leaked, so that static objects holding interned nodes can still use
+      //them while the program exits
+      static auto* table = new intern_table;
+      return *table;
+    }
+
+    //returns the canonical node that is equal to T(u), creating it if
+    //this is the first time it has been seen
+    template <typename U>
+    const T*
+    intern(U&& u)
+    {
+      T candidate(std::forward<U>(u));
+      entry key{Hash()(candidate), &candidate};
+
+      //the hash is computed before taking a lock, and only the shard that
+      //the node hashes to is locked
+      shard& s = m_shards[key.hash % shards];
+      std::lock_guard<std::mutex> lock(s.mutex);
+
+      auto iter = s.index.find(key);
+      if (iter != s.index.end())
+      {
+        return iter->node;
+      }
+
+      s.nodes.push_back(std::move(candidate));
+      key.node = &s.nodes.back();
+      s.index.insert(key);
+
+      return key.node;
+    }
+
+    size_t
+    size() const
+    {
+      size_t total = 0;
+      for (auto& s : m_shards)
+      {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        total += s.nodes.size();
+      }
+
+      return total;
+    }
+
+    private:
+
+    static constexpr size_t shards = 16;
+
+    struct entry
+    {
+      size_t hash;
+      const T* node;
+    };
+
+    struct entry_hash
+    {
+      size_t
+      operator()(const entry& e) const
+      {
+        return e.hash;
+      }
+    };
+
+    struct entry_equal
+    {
+      bool
+      operator()(const entry& a, const entry& b) const
+      {
+        return a.hash == b.hash && Equal()(*a.node, *b.node);
+      }
+    };
+
+    struct shard
+    {
+      mutable std::mutex mutex;
+
+      //a deque never moves its elements, so the canonical nodes stay put
+      std::deque<T> nodes;
+      std::unordered_set<entry, entry_hash, entry_equal> index;
+    };
+
+    shard m_shards[shards];
+  };
+
+  template <typename T>
+  class interned
+  {
+    public:
+
+    //interns in the global table of T
+    template
+    <
+      typename U,
+      typename Dummy =
+        typename std::enable_if<std::is_convertible<U, T>::value, U>::type
+    >
+    interned(U&& u)
+    : m_t(intern_table<T>::global().intern(std::forward<U>(u)))
+    {
+    }
+
+    template <typename U, typename Hash, typename Equal>
+    interned(intern_table<T, Hash, Equal>& table, U&& u)
+    : m_t(table.intern(std::forward<U>(u)))
+    {
+    }
+
+    bool
+    operator==(const interned& rhs) const
+    {
+      return m_t == rhs.m_t;
+    }
+
+    bool
+    operator!=(const interned& rhs) const
+    {
+      return m_t != rhs.m_t;
+    }
+
+    const T& get() const { return *m_t; }
+
+    private:
+    const T* m_t;
+  };
+
+  template <typename T>
+  struct is_recursive_wrapper<interned<T>>
+    : public std::true_type {};
+
+  template <typename T>
+  struct unwrapped_type<interned<T>>
+  {
+    typedef const T type;
+  };
+
+  template <typename T>
+  const T&
+  recursive_unwrap(const interned<T>& i)
+  {
+    return i.get();
+  }
+
+  template <typename T>
+  const T&
+  recursive_unwrap(interned<T>& i)
+  {
+    return i.get();
+  }
+
+  template <size_t N, typename T, typename... Types>
+  struct tuple_find_helper<N, T, interned<T>, Types...> :
+    public std::integral_constant<std::size_t, N>
+  {
+  };
+}
+
+namespace std
+{
+  template <typename T>
+  struct hash<juice::interned<T>>
+  {
+    size_t
+    operator()(const juice::interned<T>& i) const
+    {
+      return hash<const T*>()(&i.get());
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,423 @@
+// Encoding variants as byte strings that sort in the same order.
+//
+// encode_key(v) appends bytes to a string so that comparing the bytes of two
+// keys with memcmp, or the strings with operator<, orders them as operator<
+// orders the values. Keys can then be sorted with a radix sort or kept in a
+// byte ordered index, and decode_key gives the value back:
+//
+//   * a variant is a byte for its index, one more than the index so that a
+//     valueless variant, which is zero, sorts first, and then its value,
+//   * integers are big endian with the sign bit flipped if they are signed,
+//   * floating point values are big endian with the sign bit flipped if they
+//     are positive, and every bit flipped if they are negative. -0.0 is
+//     encoded as 0.0, and every NaN as one NaN that sorts after infinity,
+//   * std::string is its characters with every zero followed by 0xff, and
+//     then a zero and a one.
+//
+// No key is a prefix of another, so the keys of several values can be
+// appended to each other to make a key that orders them as a tuple.
+//
+// Other types are encoded by specialising key_codec, whose encode and decode
+// must agree with the operator< of the type. A valueless variant can be
+// encoded but not decoded, and decoding bytes that are not a key throws
+// bad_key.
+
+#ifndef JUICE_KEY_ENCODING_HPP_INCLUDED
+#define JUICE_KEY_ENCODING_HPP_INCLUDED
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+#include "variant.hpp"
+
+namespace juice
+{
+  class bad_key : public std::runtime_error
+  {
+    public:
+    explicit bad_key(const std::string& what_arg)
+    : std::runtime_error(what_arg)
+    {
+    }
+
+    explicit bad_key(const char* what_arg)
+    : std::runtime_error(what_arg)
+    {
+    }
+  };
+
+  namespace detail
+  {
+    //appends the low n bytes of u, most significant first
+    inline
+    void
+    append_big_endian(std::string& out, std::uint64_t u, size_t n)
+    {
+      for (size_t i = n; i != 0; --i)
+      {
+        out.push_back(static_cast<char>((u >> ((i - 1) * 8)) & 0xff));
+      }
+    }
+
+    inline
+    std::uint64_t
+    read_big_endian(const char*& first, const char* last, size_t n)
+    {
+      if (static_cast<size_t>(last - first) < n)
+      {
+        raise(bad_key("Key is too short"));
+      }
+
+      std::uint64_t u = 0;
+      for (size_t i = 0; i != n; ++i)
+      {
+        u = (u << 8) | static_cast<unsigned char>(*first);
+        ++first;
+      }
+      return u;
+    }
+
+    template <size_t Size>
+    struct float_bits;
+
+    template <>
+    struct float_bits<4>
+    {
+      typedef std::uint32_t type;
+    };
+
+    template <>
+    struct float_bits<8>
+    {
+      typedef std::uint64_t type;
+    };
+  }
+
+  template <typename T, typename = void>
+  struct key_codec;
+
+  template <typename T>
+  struct key_codec<T, std::enable_if_t<
+    std::is_integral<T>::value && !std::is_same<T, bool>::value>>
+  {
+    void
+    encode(std::string& out, T t) const
+    {
+      detail::append_big_endian(out, static_cast<U>(t) ^ sign, sizeof(T));
+    }
+
+    T
+    decode(const char*& first, const char* last) const
+    {
+      return static_cast<T>(static_cast<U>(
+        detail::read_big_endian(first, last, sizeof(T))) ^ sign);
+    }
+
+    private:
+    typedef std::make_unsigned_t<T> U;
+
+    static constexpr U sign = std::is_signed<T>::value ?
+      static_cast<U>(U(1) << (sizeof(T) * 8 - 1)) : U(0);
+  };
+
+  template <>
+  struct key_codec<bool>
+  {
+    void
+    encode(std::string& out, bool b) const
+    {
+      out.push_back(b ? 1 : 0);
+    }
+
+    bool
+    decode(const char*& first, const char* last) const
+    {
+      std::uint64_t b = detail::read_big_endian(first, last, 1);
+      if (b > 1)
+      {
+        detail::raise(bad_key("Key has a bad bool"));
+      }
+      return b == 1;
+    }
+  };
+
+  template <typename T>
+  struct key_codec<T, std::enable_if_t<std::is_enum<T>::value>>
+  {
+    void
+    encode(std::string& out, T t) const
+    {
+      key_codec<U>().encode(out, static_cast<U>(t));
+    }
+
+    T
+    decode(const char*& first, const char* last) const
+    {
+      return static_cast<T>(key_codec<U>().decode(first, last));
+    }
+
+    private:
+    typedef std::underlying_type_t<T> U;
+  };
+
+  template <typename T>
+  struct key_codec<T, std::enable_if_t<std::is_floating_point<T>::value>>
+  {
+    static_assert(std::numeric_limits<T>::is_iec559,
+      "floating point values must be IEEE 754");
+
+    void
+    encode(std::string& out, T t) const
+    {
+      if (t == 0)
+      {
+        t = 0;
+      }
+      else if (std::isnan(t))
+      {
+        t = std::numeric_limits<T>::quiet_NaN();
+      }
+
+      bits b;
+      std::memcpy(&b, &t, sizeof(b));
+      b = (b & sign) != 0 ? static_cast<bits>(~b) : (b | sign);
+      detail::append_big_endian(out, b, sizeof(b));
+    }
+
+    T
+    decode(const char*& first, const char* last) const
+    {
+      bits b = static_cast<bits>(
+        detail::read_big_endian(first, last, sizeof(bits)));
+      b = (b & sign) != 0 ? (b ^ sign) : static_cast<bits>(~b);
+
+      T t;
+      std::memcpy(&t, &b, sizeof(t));
+      return t;
+    }
+
+    private:
+    typedef typename detail::float_bits<sizeof(T)>::type bits;
+
+    static constexpr bits sign = bits(1) << (sizeof(bits) * 8 - 1);
+  };
+
+  template <typename Allocator>
+  struct key_codec<std::basic_string<char, std::char_traits<char>, Allocator>>
+  {
+    typedef std::basic_string<char, std::char_traits<char>, Allocator> string;
+
+    void
+    encode(std::string& out, const string& s) const
+    {
+      const char* p = s.data();
+      const char* end = p + s.size();
+      while (p != end)
+      {
+        const char* zero = static_cast<const char*>(
+          std::memchr(p, 0, end - p));
+        if (zero == nullptr)
+        {
+          out.append(p, end);
+          break;
+        }
+
+        out.append(p, zero + 1);
+        out.push_back('\xff');
+        p = zero + 1;
+      }
+
+      out.push_back('\0');
+      out.push_back('\1');
+    }
+
+    string
+    decode(const char*& first, const char* last) const
+    {
+      string s;
+      while (true)
+      {
+        const char* zero = static_cast<const char*>(
+          std::memchr(first, 0, last - first));
+        if (zero == nullptr || zero + 1 == last)
+        {
+          detail::raise(bad_key("Key has an unterminated string"));
+        }
+
+        s.append(first, zero);
+        first = zero + 2;
+
+        if (zero[1] == '\1')
+        {
+          return s;
+        }
+        else if (zero[1] == '\xff')
+        {
+          s.push_back('\0');
+        }
+        else
+        {
+          detail::raise(bad_key("Key has a bad escape in a string"));
+        }
+      }
+    }
+  };
+
+  template <>
+  struct key_codec<monostate>
+  {
+    void
+    encode(std::string&, const monostate&) const
+    {
+    }
+
+    monostate
+    decode(const char*&, const char*) const
+    {
+      return monostate();
+    }
+  };
+
+  template <typename T>
+  struct key_codec<recursive_wrapper<T>>
+  {
+    void
+    encode(std::string& out, const recursive_wrapper<T>& r) const
+    {
+      key_codec<T>().encode(out, r.get());
+    }
+
+    recursive_wrapper<T>
+    decode(const char*& first, const char* last) const
+    {
+      return recursive_wrapper<T>(key_codec<T>().decode(first, last));
+    }
+  };
+
+  template <typename... Types>
+  struct key_codec<variant<Types...>>
+  {
+    static_assert(sizeof...(Types) < 255,
+      "the index of a variant must fit in a byte");
+
+    typedef variant<Types...> V;
+
+    void
+    encode(std::string& out, const V& v) const
+    {
+      if (v.valueless_by_exception())
+      {
+        out.push_back('\0');
+        return;
+      }
+
+      encode(out, v, std::index_sequence_for<Types...>());
+    }
+
+    V
+    decode(const char*& first, const char* last) const
+    {
+      return decode(first, last, std::index_sequence_for<Types...>());
+    }
+
+    private:
+    template <size_t... I>
+    static
+    void
+    encode(std::string& out, const V& v, std::index_sequence<I...>)
+    {
+      typedef void (*encoder)(std::string&, const V&);
+      static constexpr encoder table[] = {&encode_at<I>...};
+
+      out.push_back(static_cast<char>(v.index() + 1));
+      table[v.index()](out, v);
+    }
+
+    template <size_t I>
+    static
+    void
+    encode_at(std::string& out, const V& v)
+    {
+      typedef std::tuple_element_t<I, V> T;
+      key_codec<std::decay_t<T>>().encode(out, v.template get<I>());
+    }
+
+    template <size_t... I>
+    static
+    V
+    decode(const char*& first, const char* last, std::index_sequence<I...>)
+    {
+      typedef V (*decoder)(const char*&, const char*);
+      static constexpr decoder table[] = {&decode_at<I>...};
+
+      size_t index = detail::read_big_endian(first, last, 1);
+      if (index == 0)
+      {
+        detail::raise(bad_key("Can't decode a valueless variant"));
+      }
+      else if (index > sizeof...(Types))
+      {
+        detail::raise(bad_key("Key has a bad variant index"));
+      }
+
+      return table[index - 1](first, last);
+    }
+
+    template <size_t I>
+    static
+    V
+    decode_at(const char*& first, const char* last)
+    {
+      typedef std::tuple_element_t<I, V> T;
+      return V(emplaced_index<I>,
+        key_codec<std::decay_t<T>>().decode(first, last));
+    }
+  };
+
+  //appends the key of t to out
+  template <typename T>
+  void
+  encode_key(const T& t, std::string& out)
+  {
+    key_codec<T>().encode(out, t);
+  }
+
+  template <typename T>
+  std::string
+  encode_key(const T& t)
+  {
+    std::string out;
+    encode_key(t, out);
+    return out;
+  }
+
+  //decodes the key of a T at first, and moves first past it
+  template <typename T>
+  T
+  decode_key(const char*& first, const char* last)
+  {
+    return key_codec<T>().decode(first, last);
+  }
+
+  //decodes a key that is the key of a T and nothing else
+  template <typename T>
+  T
+  decode_key(const std::string& key)
+  {
+    const char* first = key.data();
+    const char* last = first + key.size();
+
+    T t = decode_key<T>(first, last);
+    if (first != last)
+    {
+      detail::raise(bad_key("Key is too long"));
+    }
+    return t;
+  }
+}
+
+#endif
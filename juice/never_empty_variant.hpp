@@ -0,0 +1,672 @@
+// A variant that is never empty.
+//
+// never_empty_variant<Types...> has the same interface as variant, but it can
+// never be valueless_by_exception. A new value is always constructed before
+// the old one is destroyed, so if constructing the new value throws, the
+// variant still holds the old one.
+//
+// If every alternative can be moved without throwing, the new value is
+// constructed to the side and then moved into the one buffer of the variant.
+// Otherwise it keeps two buffers, like the double storage of Boost.Variant,
+// and a new value is constructed in the buffer that isn't in use, which
+// makes the variant twice the size of a variant with the same types.
+//
+// Since there is always a value, visiting and destroying the variant never
+// check for the empty state.
+//
+// Constructing the new value before destroying the old one also means that a
+// recursive variant can be assigned a part of its own tree.
+
+#ifndef JUICE_NEVER_EMPTY_VARIANT_HPP_INCLUDED
+#define JUICE_NEVER_EMPTY_VARIANT_HPP_INCLUDED
+
+#include "variant.hpp"
+
+namespace juice
+{
+  namespace detail
+  {
+    template <typename T>
+    void
+    destroy_value(void* p)
+    {
+      static_cast<T*>(p)->~T();
+    }
+
+    template <typename T>
+    void
+    copy_value(void* to, const void* from)
+    {
+      new (to) T(*static_cast<const T*>(from));
+    }
+
+    template <typename T>
+    void
+    move_value(void* to, void* from)
+    {
+      new (to) T(std::move(*static_cast<T*>(from)));
+    }
+
+    template <typename T>
+    void
+    copy_assign_value(void* to, const void* from)
+    {
+      *static_cast<T*>(to) = *static_cast<const T*>(from);
+    }
+
+    template <typename T>
+    void
+    move_assign_value(void* to, void* from)
+    {
+      *static_cast<T*>(to) = std::move(*static_cast<T*>(from));
+    }
+
+    template <typename T>
+    bool
+    equal_values(const void* a, const void* b)
+    {
+      return *static_cast<const T*>(a) == *static_cast<const T*>(b);
+    }
+
+    template <typename T>
+    int
+    compare_values(const void* a, const void* b)
+    {
+      return three_way(recursive_unwrap(*static_cast<const T*>(a)),
+        recursive_unwrap(*static_cast<const T*>(b)));
+    }
+  }
+
+  template <typename... Types>
+  class never_empty_variant
+  {
+    private:
+
+    typedef typename detail::pack_first<Types...>::type First;
+
+    typedef typename std::aligned_storage<
+      max<detail::storage_size, Types...>::value,
+      max<detail::storage_align, Types...>::value
+    >::type buffer;
+
+    template <typename T>
+    using assigned_type = detail::assigned_alternative_t<T, Types...>;
+
+    template <size_t I>
+    using alternative = std::tuple_element_t<I, std::tuple<Types...>>;
+
+    //a second buffer is only needed when moving a new value into place might
+    //throw
+    static constexpr bool double_buffered = !conjunction<
+      std::is_nothrow_move_constructible<ref_type_t<Types>>::value...
+    >::value;
+
+    public:
+
+    template <typename Dummy = char>
+    never_empty_variant(typename std::enable_if<
+        std::is_default_constructible<First>::value, Dummy
+      >::type* = nullptr
+    )
+    noexcept(std::is_nothrow_default_constructible<First>::value)
+    : m_which(0)
+    , m_buffer(0)
+    {
+      new (active()) First();
+    }
+
+    template
+    <
+      typename T,
+      typename =
+        typename std::enable_if
+        <
+          !std::is_same<std::decay_t<T>, never_empty_variant>::value
+        >::type
+    >
+    never_empty_variant(T&& t)
+    : m_which(tuple_find<assigned_type<T>, never_empty_variant>::value)
+    , m_buffer(0)
+    {
+      new (active()) ref_type_t<assigned_type<T>>(std::forward<T>(t));
+    }
+
+    template <size_t I, typename... Args>
+    explicit
+    never_empty_variant(emplaced_index_t<I>, Args&&... args)
+    : m_which(I)
+    , m_buffer(0)
+    {
+      new (active()) ref_type_t<alternative<I>>(std::forward<Args>(args)...);
+    }
+
+    template <size_t I, typename F>
+    never_empty_variant(emplaced_with_t<I>, F&& f)
+    : m_which(I)
+    , m_buffer(0)
+    {
+      new (active()) ref_type_t<alternative<I>>(std::forward<F>(f)());
+    }
+
+    template <typename T, typename... Args>
+    explicit
+    never_empty_variant(emplaced_type_t<T>, Args&&... args)
+    : never_empty_variant(
+        emplaced_index<tuple_find<T, never_empty_variant>::value>,
+        std::forward<Args>(args)...)
+    {
+    }
+
+    never_empty_variant(const never_empty_variant& rhs)
+    : m_which(rhs.m_which)
+    , m_buffer(0)
+    {
+      copiers()[m_which](active(), rhs.active());
+    }
+
+    never_empty_variant(never_empty_variant&& rhs)
+    noexcept(conjunction<
+      std::is_nothrow_move_constructible<ref_type_t<Types>>::value...
+    >::value)
+    : m_which(rhs.m_which)
+    , m_buffer(0)
+    {
+      movers()[m_which](active(), rhs.active());
+    }
+
+    ~never_empty_variant()
+    {
+      destroyers()[m_which](active());
+    }
+
+    never_empty_variant&
+    operator=(const never_empty_variant& rhs)
+    {
+      if (m_which == rhs.m_which)
+      {
+        copy_assigners()[m_which](active(), rhs.active());
+      }
+      else
+      {
+        replace(rhs.m_which, [&rhs] (void* p) {
+          copiers()[rhs.m_which](p, rhs.active());
+        });
+      }
+
+      return *this;
+    }
+
+    never_empty_variant&
+    operator=(never_empty_variant&& rhs)
+    noexcept(conjunction<(
+      std::is_nothrow_move_constructible<ref_type_t<Types>>::value &&
+      std::is_nothrow_move_assignable<ref_type_t<Types>>::value
+    )...>::value)
+    {
+      if (m_which == rhs.m_which)
+      {
+        move_assigners()[m_which](active(), rhs.active());
+      }
+      else
+      {
+        replace(rhs.m_which, [&rhs] (void* p) {
+          movers()[rhs.m_which](p, rhs.active());
+        });
+      }
+
+      return *this;
+    }
+
+    template
+    <
+      typename T,
+      typename =
+        typename std::enable_if
+        <
+          !std::is_same<std::decay_t<T>, never_empty_variant>::value
+        >::type
+    >
+    never_empty_variant&
+    operator=(T&& t)
+    {
+      typedef assigned_type<T> type;
+      constexpr size_t I = tuple_find<type, never_empty_variant>::value;
+
+      if (m_which == I)
+      {
+        *static_cast<ref_type_t<type>*>(active()) = std::forward<T>(t);
+      }
+      else
+      {
+        replace(I, [&t] (void* p) {
+          new (p) ref_type_t<type>(std::forward<T>(t));
+        });
+      }
+
+      return *this;
+    }
+
+    template <size_t I, typename... Args>
+    void
+    emplace(Args&&... args)
+    {
+      replace(I, [&] (void* p) {
+        new (p) ref_type_t<alternative<I>>(std::forward<Args>(args)...);
+      });
+    }
+
+    template <typename T, typename... Args>
+    void
+    emplace(Args&&... args)
+    {
+      emplace<tuple_find<T, never_empty_variant>::value>(
+        std::forward<Args>(args)...);
+    }
+
+    template <size_t I, typename F>
+    void
+    emplace_with(F&& f)
+    {
+      replace(I, [&f] (void* p) {
+        new (p) ref_type_t<alternative<I>>(std::forward<F>(f)());
+      });
+    }
+
+    template <typename T, typename F>
+    void
+    emplace_with(F&& f)
+    {
+      emplace_with<tuple_find<T, never_empty_variant>::value>(
+        std::forward<F>(f));
+    }
+
+    size_t index() const { return m_which; }
+
+    size_t which() const { return m_which; }
+
+    constexpr bool valueless_by_exception() const { return false; }
+
+    bool
+    operator==(const never_empty_variant& rhs) const
+    {
+      return m_which == rhs.m_which &&
+        comparers()[m_which](active(), rhs.active());
+    }
+
+    //returns less than, equal to or greater than zero as *this is less
+    //than, equal to or greater than rhs, ordering by index first
+    int
+    compare(const never_empty_variant& rhs) const
+    {
+      if (m_which != rhs.m_which)
+      {
+        return m_which < rhs.m_which ? -1 : 1;
+      }
+
+      return three_way_comparers()[m_which](active(), rhs.active());
+    }
+
+    void
+    swap(never_empty_variant& rhs)
+    noexcept(std::is_nothrow_move_constructible<never_empty_variant>::value &&
+      std::is_nothrow_move_assignable<never_empty_variant>::value)
+    {
+      if (this != &rhs)
+      {
+        never_empty_variant tmp(std::move(rhs));
+        rhs = std::move(*this);
+        *this = std::move(tmp);
+      }
+    }
+
+    template <size_t I>
+    const alternative<I>&
+    get() const
+    {
+      if (m_which != I)
+      {
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
+      }
+
+      return *static_cast<const ref_type_t<alternative<I>>*>(active());
+    }
+
+    template <size_t I>
+    alternative<I>&
+    get()
+    {
+      if (m_which != I)
+      {
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
+      }
+
+      return *static_cast<ref_type_t<alternative<I>>*>(active());
+    }
+
+    template <typename Internal, typename Visitor, typename... Args>
+    decltype(auto)
+    apply_visitor(Visitor&& visitor, Args&&... args)
+    {
+      return visit_buffer<Internal>(&m_storage[m_buffer],
+        std::forward<Visitor>(visitor), std::forward<Args>(args)...);
+    }
+
+    template <typename Internal, typename Visitor, typename... Args>
+    decltype(auto)
+    apply_visitor(Visitor&& visitor, Args&&... args) const
+    {
+      return visit_buffer<Internal>(&m_storage[m_buffer],
+        std::forward<Visitor>(visitor), std::forward<Args>(args)...);
+    }
+
+    private:
+
+    void* active() { return &m_storage[m_buffer]; }
+    const void* active() const { return &m_storage[m_buffer]; }
+
+    //make constructs a value of the alternative which in the memory that it
+    //is given, and that value replaces the current one. The current value is
+    //destroyed only after make returns, so it is kept if make throws, and
+    //make can copy from it.
+    template <typename Make>
+    void
+    replace(size_t which, Make make)
+    {
+      replace(which, make, std::integral_constant<bool, double_buffered>());
+    }
+
+    template <typename Make>
+    void
+    replace(size_t which, Make& make, std::true_type)
+    {
+      make(&m_storage[1 - m_buffer]);
+      destroyers()[m_which](active());
+      m_buffer = 1 - m_buffer;
+      m_which = which;
+    }
+
+    template <typename Make>
+    void
+    replace(size_t which, Make& make, std::false_type)
+    {
+      buffer value;
+      make(&value);
+      destroyers()[m_which](active());
+      movers()[which](active(), &value);
+      destroyers()[which](&value);
+      m_which = which;
+    }
+
+    template <typename Internal, typename Buffer, typename Visitor,
+      typename... Args>
+    decltype(auto)
+    visit_buffer(Buffer* storage, Visitor&& visitor, Args&&... args) const
+    {
+      typedef typename std::common_type<
+        decltype(visitor_caller<Internal&&, Types, Buffer*&&, Visitor,
+          Args&&...>(
+            Internal(), std::move(storage), std::forward<Visitor>(visitor),
+            std::forward<Args>(args)...))...
+      >::type result;
+
+      typedef result (*caller)(Internal&&, Buffer*&&, Visitor&&, Args&&...);
+
+      static constexpr caller callers[] = {
+        &visitor_caller<Internal&&, Types, Buffer*&&, Visitor, Args&&...>...
+      };
+
+      return callers[m_which](Internal(), std::move(storage),
+        std::forward<Visitor>(visitor), std::forward<Args>(args)...);
+    }
+
+    typedef void (*destroyer)(void*);
+    typedef void (*copier)(void*, const void*);
+    typedef void (*mover)(void*, void*);
+    typedef bool (*comparer)(const void*, const void*);
+    typedef int (*three_way_comparer)(const void*, const void*);
+
+    static
+    const destroyer*
+    destroyers()
+    {
+      static constexpr destroyer table[] = {
+        &detail::destroy_value<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    static
+    const copier*
+    copiers()
+    {
+      static constexpr copier table[] = {
+        &detail::copy_value<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    static
+    const mover*
+    movers()
+    {
+      static constexpr mover table[] = {
+        &detail::move_value<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    static
+    const copier*
+    copy_assigners()
+    {
+      static constexpr copier table[] = {
+        &detail::copy_assign_value<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    static
+    const mover*
+    move_assigners()
+    {
+      static constexpr mover table[] = {
+        &detail::move_assign_value<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    static
+    const comparer*
+    comparers()
+    {
+      static constexpr comparer table[] = {
+        &detail::equal_values<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    static
+    const three_way_comparer*
+    three_way_comparers()
+    {
+      static constexpr three_way_comparer table[] = {
+        &detail::compare_values<ref_type_t<Types>>...
+      };
+      return table;
+    }
+
+    buffer m_storage[double_buffered ? 2 : 1];
+    size_t m_which;
+    unsigned char m_buffer;
+  };
+
+  template <typename... Types>
+  void
+  swap(never_empty_variant<Types...>& a, never_empty_variant<Types...>& b)
+  noexcept(noexcept(a.swap(b)))
+  {
+    a.swap(b);
+  }
+
+  template <typename... Types>
+  int
+  compare(const never_empty_variant<Types...>& v,
+    const never_empty_variant<Types...>& w)
+  {
+    return v.compare(w);
+  }
+
+  template <typename... Types>
+  bool
+  operator!=(const never_empty_variant<Types...>& v,
+    const never_empty_variant<Types...>& w)
+  {
+    return !(v == w);
+  }
+
+  template <typename... Types>
+  bool
+  operator<(const never_empty_variant<Types...>& v,
+    const never_empty_variant<Types...>& w)
+  {
+    return v.compare(w) < 0;
+  }
+
+  template <typename... Types>
+  bool
+  operator>(const never_empty_variant<Types...>& v,
+    const never_empty_variant<Types...>& w)
+  {
+    return v.compare(w) > 0;
+  }
+
+  template <typename... Types>
+  bool
+  operator<=(const never_empty_variant<Types...>& v,
+    const never_empty_variant<Types...>& w)
+  {
+    return v.compare(w) <= 0;
+  }
+
+  template <typename... Types>
+  bool
+  operator>=(const never_empty_variant<Types...>& v,
+    const never_empty_variant<Types...>& w)
+  {
+    return v.compare(w) >= 0;
+  }
+
+  template <typename T, typename... Types>
+  struct tuple_find<T, never_empty_variant<Types...>> :
+    public tuple_find<T, std::tuple<Types...>>
+  {
+  };
+
+  template <size_t I, typename... Types>
+  auto&
+  get(never_empty_variant<Types...>& v)
+  {
+    return recursive_unwrap(v.template get<I>());
+  }
+
+  template <size_t I, typename... Types>
+  auto&
+  get(const never_empty_variant<Types...>& v)
+  {
+    return recursive_unwrap(v.template get<I>());
+  }
+
+  template <size_t I, typename... Types>
+  auto
+  get_if(never_empty_variant<Types...>* v)
+  {
+    return v->index() == I ? &get<I>(*v) : nullptr;
+  }
+
+  template <size_t I, typename... Types>
+  auto
+  get_if(const never_empty_variant<Types...>* v)
+  {
+    return v->index() == I ? &get<I>(*v) : nullptr;
+  }
+
+  template <typename T, typename... Types>
+  auto&
+  get(never_empty_variant<Types...>& v)
+  {
+    return get<tuple_find<T, never_empty_variant<Types...>>::value>(v);
+  }
+
+  template <typename T, typename... Types>
+  auto&
+  get(const never_empty_variant<Types...>& v)
+  {
+    return get<tuple_find<T, never_empty_variant<Types...>>::value>(v);
+  }
+
+  template <typename T, typename... Types>
+  auto
+  get_if(never_empty_variant<Types...>* v)
+  {
+    return get_if<tuple_find<T, never_empty_variant<Types...>>::value>(v);
+  }
+
+  template <typename T, typename... Types>
+  auto
+  get_if(const never_empty_variant<Types...>* v)
+  {
+    return get_if<tuple_find<T, never_empty_variant<Types...>>::value>(v);
+  }
+}
+
+namespace std
+{
+  template <typename... Types>
+  class tuple_size<juice::never_empty_variant<Types...>> :
+    public std::integral_constant<size_t, sizeof...(Types)>
+  {
+  };
+
+  template <size_t I, typename... Types>
+  class tuple_element<I, juice::never_empty_variant<Types...>>
+    : public tuple_element<I, tuple<Types...>> { };
+
+  //hashes the same as a juice::variant holding the same value
+  template <typename... Types>
+  struct hash<juice::never_empty_variant<Types...>>
+  {
+    size_t
+    operator()(const juice::never_empty_variant<Types...>& v) const
+    {
+      return hash_value(v, std::index_sequence_for<Types...>());
+    }
+
+    private:
+    typedef juice::never_empty_variant<Types...> V;
+
+    template <size_t... I>
+    static
+    size_t
+    hash_value(const V& v, std::index_sequence<I...>)
+    {
+      typedef size_t (*hasher)(const V&);
+      static constexpr hasher table[] = {&hash_at<I>...};
+
+      return table[v.index()](v);
+    }
+
+    template <size_t I>
+    static
+    size_t
+    hash_at(const V& v)
+    {
+      typedef std::tuple_element_t<I, V> T;
+      return juice::detail::hash_combine(juice::detail::index_seed<I>::value,
+        hash<T>()(v.template get<I>()));
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,319 @@
+// Relocatable recursive trees for juice::variant.
+//
+// offset_wrapper<T> can be used in place of recursive_wrapper<T>. Instead of
+// a pointer to a heap allocated node, it holds the 32 bit offset of the node
+// in an offset_arena. A tree of variants built this way contains no
+// pointers, so the memory of the arena can be copied, written to a file or
+// mapped from one, and used again without any fix-up.
+//
+// Nodes are resolved in the arena that is bound to the current thread with
+// offset_arena::scope, which must be active whenever a node is created or
+// accessed.
+//
+// The nodes are owned by the arena and are never destroyed, all of the
+// memory is released at once with the arena. Anything stored in a node
+// should therefore not own resources, which would not survive being copied
+// out of the arena anyway.
+
+#ifndef JUICE_OFFSET_WRAPPER_HPP_INCLUDED
+#define JUICE_OFFSET_WRAPPER_HPP_INCLUDED
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+
+#include "thread_binding.hpp"
+#include "variant.hpp"
+
+namespace juice
+{
+  class offset_arena : public detail::thread_bound<offset_arena>
+  {
+    public:
+
+    typedef std::uint32_t offset_type;
+
+    static constexpr offset_type npos = static_cast<offset_type>(-1);
+
+    //an arena that owns capacity bytes of memory, it never grows because
+    //that would invalidate references into it while nodes are being built
+    explicit
+    offset_arena(size_t capacity)
+    : m_owned(new std::max_align_t[blocks(capacity)])
+    , m_memory(reinterpret_cast<unsigned char*>(m_owned.get()))
+    , m_capacity(capacity)
+    , m_size(0)
+    {
+      check_capacity();
+    }
+
+    //an arena in memory owned by someone else, of which the first size bytes
+    //are already in use, for example a file that has been mapped into memory
+    //memory must be aligned to alignof(std::max_align_t)
+    offset_arena(void* memory, size_t capacity, size_t size = 0)
+    : m_memory(static_cast<unsigned char*>(memory))
+    , m_capacity(capacity)
+    , m_size(size)
+    {
+      check_capacity();
+      assert(size <= capacity);
+    }
+
+    offset_arena(const offset_arena&) = delete;
+
+    offset_arena&
+    operator=(const offset_arena&) = delete;
+
+    //replaces the contents of the arena with an image that was taken
+    //from the data() and size() of another arena
+    void
+    assign(const void* image, size_t size)
+    {
+      if (size > m_capacity)
+      {
+        detail::raise(std::bad_alloc());
+      }
+
+      std::memcpy(m_memory, image, size);
+      m_size = size;
+    }
+
+    template <typename T, typename... Args>
+    offset_type
+    construct(Args&&... args)
+    {
+      static_assert(std::is_trivially_destructible<T>::value,
+        "offset_arena never runs destructors");
+
+      size_t offset = (m_size + alignof(T) - 1) / alignof(T) * alignof(T);
+      if (offset + sizeof(T) > m_capacity)
+      {
+        detail::raise(std::bad_alloc());
+      }
+
+      //nested nodes are allocated while this one is constructed, so the
+      //space has to be claimed first
+      m_size = offset + sizeof(T);
+      new (m_memory + offset) T(std::forward<Args>(args)...);
+
+      return static_cast<offset_type>(offset);
+    }
+
+    template <typename T>
+    T&
+    at(offset_type offset)
+    {
+      assert(offset != npos && offset + sizeof(T) <= m_size);
+      return *reinterpret_cast<T*>(m_memory + offset);
+    }
+
+    template <typename T>
+    const T&
+    at(offset_type offset) const
+    {
+      assert(offset != npos && offset + sizeof(T) <= m_size);
+      return *reinterpret_cast<const T*>(m_memory + offset);
+    }
+
+    const void* data() const { return m_memory; }
+
+    size_t size() const { return m_size; }
+
+    size_t capacity() const { return m_capacity; }
+
+    static
+    offset_arena&
+    current()
+    {
+      assert(bound() != nullptr && "no offset_arena is bound to this thread");
+      return *bound();
+    }
+
+    private:
+
+    static
+    size_t
+    blocks(size_t capacity)
+    {
+      return (capacity + sizeof(std::max_align_t) - 1) /
+        sizeof(std::max_align_t);
+    }
+
+    void
+    check_capacity() const
+    {
+      if (m_capacity >= npos)
+      {
+        detail::raise(std::length_error("offset_arena is limited to 4GB"));
+      }
+    }
+
+    std::unique_ptr<std::max_align_t[]> m_owned;
+    unsigned char* m_memory;
+    size_t m_capacity;
+    size_t m_size;
+  };
+
+  template <typename T>
+  class offset_wrapper
+  {
+    public:
+
+    typedef offset_arena::offset_type offset_type;
+
+    template
+    <
+      typename U,
+      typename Dummy =
+        typename std::enable_if<std::is_convertible<U, T>::value, U>::type
+    >
+    offset_wrapper(U&& u)
+    : m_offset(offset_arena::current().template construct<T>(
+        std::forward<U>(u)))
+    {
+    }
+
+    offset_wrapper(const offset_wrapper& rhs)
+    : m_offset(offset_arena::current().template construct<T>(rhs.get()))
+    {
+    }
+
+    offset_wrapper(offset_wrapper&& rhs) noexcept
+    : m_offset(rhs.m_offset)
+    {
+      rhs.m_offset = offset_arena::npos;
+    }
+
+    offset_wrapper&
+    operator=(const offset_wrapper& rhs)
+    {
+      assign(rhs.get());
+      return *this;
+    }
+
+    offset_wrapper&
+    operator=(offset_wrapper&& rhs) noexcept
+    {
+      //the old node stays in the arena until the arena goes
+      if (this != &rhs)
+      {
+        m_offset = rhs.m_offset;
+        rhs.m_offset = offset_arena::npos;
+      }
+      return *this;
+    }
+
+    offset_wrapper&
+    operator=(const T& t)
+    {
+      assign(t);
+      return *this;
+    }
+
+    offset_wrapper&
+    operator=(T&& t)
+    {
+      assign(std::move(t));
+      return *this;
+    }
+
+    //a wrapper that has been moved from only equals another one
+    bool
+    operator==(const offset_wrapper& rhs) const
+    {
+      if (m_offset == rhs.m_offset)
+      {
+        return true;
+      }
+      else if (m_offset == offset_arena::npos ||
+        rhs.m_offset == offset_arena::npos)
+      {
+        return false;
+      }
+
+      return get() == rhs.get();
+    }
+
+    T& get() { return offset_arena::current().template at<T>(m_offset); }
+
+    const T&
+    get() const
+    {
+      return offset_arena::current().template at<T>(m_offset);
+    }
+
+    offset_type offset() const { return m_offset; }
+
+    private:
+    offset_type m_offset;
+
+    //a wrapper that has been moved from has no node, and gets a new one
+    template <typename U>
+    void
+    assign(U&& u)
+    {
+      if (m_offset == offset_arena::npos)
+      {
+        m_offset = offset_arena::current().template construct<T>(
+          std::forward<U>(u));
+      }
+      else
+      {
+        get() = std::forward<U>(u);
+      }
+    }
+  };
+
+  template <typename T>
+  struct is_recursive_wrapper<offset_wrapper<T>>
+    : public std::true_type {};
+
+  template <typename T>
+  struct is_trivially_relocatable<offset_wrapper<T>>
+    : public std::true_type {};
+
+  template <typename T>
+  struct unwrapped_type<offset_wrapper<T>>
+  {
+    typedef T type;
+  };
+
+  template <typename T>
+  const T&
+  recursive_unwrap(const offset_wrapper<T>& o)
+  {
+    return o.get();
+  }
+
+  template <typename T>
+  T&
+  recursive_unwrap(offset_wrapper<T>& o)
+  {
+    return o.get();
+  }
+
+  template <size_t N, typename T, typename... Types>
+  struct tuple_find_helper<N, T, offset_wrapper<T>, Types...> :
+    public std::integral_constant<std::size_t, N>
+  {
+  };
+}
+
+namespace std
+{
+  template <typename T>
+  struct hash<juice::offset_wrapper<T>>
+  {
+    size_t
+    operator()(const juice::offset_wrapper<T>& o) const
+    {
+      return hash<T>()(o.get());
+    }
+  };
+}
+
+#endif
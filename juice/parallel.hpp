@@ -0,0 +1,463 @@
+// Copying and folding recursive variant trees on many threads.
+//
+// Both split a tree into independent subtrees which are handed to a
+// task_pool. Whether a subtree is worth splitting is decided by counting its
+// nodes, but the count stops at the grain size, so a subtree is never
+// counted further than it takes to know that it is large. Subtrees smaller
+// than the grain are done on one thread as usual, and the splitting stops
+// once there are enough tasks to keep every thread of the pool busy.
+//
+// The children of a node are found with for_each_child, as for fold.
+//
+// parallel_fold calls the algebra from several threads at once. It folds
+// each small subtree with fold, and then combines the results of the split
+// nodes on the calling thread.
+//
+// parallel_copy only splits trees of recursive_wrapper<T> for which
+// node_cloner<T> is specialised as parallel_cloner<T>, which costs a thread
+// local lookup on every copy of such a node, and it doesn't compile for a
+// tree without one, which could only be copied on the calling thread. The
+// node of a split subtree is copied with the copies of its children
+// postponed, they are allocated and then constructed later by tasks of their
+// own. A copy that throws at that point can't be undone, so it calls
+// std::terminate instead.
+
+#ifndef JUICE_PARALLEL_HPP_INCLUDED
+#define JUICE_PARALLEL_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "fold.hpp"
+#include "task_pool.hpp"
+
+namespace juice
+{
+  //the number of nodes in a subtree below which it is not split
+  constexpr size_t parallel_grain = 4096;
+
+  namespace detail
+  {
+    //a node that has been allocated but not constructed yet
+    struct deferred_copy
+    {
+      void* target;
+      const void* source;
+      void (*copy)(void* target, const void* source);
+    };
+
+    //while this is set, copying a recursive_wrapper of a parallel_cloner
+    //only allocates the new node and records the copy here, so that it can
+    //be done by another thread
+    inline
+    std::vector<deferred_copy>*&
+    deferred_copies()
+    {
+      static thread_local std::vector<deferred_copy>* copies = nullptr;
+      return copies;
+    }
+
+    template <typename T>
+    void
+    copy_node(void* target, const void* source)
+    {
+      new (target) T(*static_cast<const T*>(source));
+    }
+  }
+
+  //specialise node_cloner<T> as parallel_cloner<T> to let parallel_copy
+  //split trees of recursive_wrapper<T>, other nodes are copied with their
+  //subtrees on the thread that copies them
+  template <typename T>
+  struct parallel_cloner
+  {
+    static
+    T*
+    clone(const T& t)
+    {
+      auto copies = detail::deferred_copies();
+      if (copies == nullptr)
+      {
+        return new T(t);
+      }
+
+      void* memory = ::operator new(sizeof(T));
+      JUICE_TRY
+      {
+        copies->push_back(
+          detail::deferred_copy{memory, &t, &detail::copy_node<T>});
+      }
+      JUICE_CATCH_ALL
+      {
+        ::operator delete(memory);
+        JUICE_RETHROW;
+      }
+
+      return static_cast<T*>(memory);
+    }
+  };
+
+  namespace detail
+  {
+    //whether copying an alternative of a tree can be split
+    template <typename T>
+    struct splits_copies : public std::false_type {};
+
+    template <typename T>
+    struct splits_copies<recursive_wrapper<T>>
+      : public std::is_base_of<parallel_cloner<T>, node_cloner<T>> {};
+
+    template <typename Variant>
+    struct has_parallel_cloner;
+
+    template <typename... Types>
+    struct has_parallel_cloner<variant<Types...>>
+      : public std::integral_constant<bool,
+          !conjunction<!splits_copies<Types>::value...>::value> {};
+
+    template <typename Variant>
+    struct child_lister
+    {
+      template <typename T>
+      void
+      operator()(const T& t) const
+      {
+        list(t, is_recursive_wrapper<T>());
+      }
+
+      template <typename T>
+      void
+      list(const T&, std::false_type) const
+      {
+      }
+
+      template <typename T>
+      void
+      list(const T& t, std::true_type) const
+      {
+        auto& children = m_children;
+        for_each_child(recursive_unwrap(t), [&children] (const Variant& c) {
+          children.push_back(&c);
+        });
+      }
+
+      std::vector<const Variant*>& m_children;
+    };
+
+    //adds the children of the node held by tree to children
+    template <typename Variant>
+    void
+    list_children(const Variant& tree, std::vector<const Variant*>& children)
+    {
+      tree.template apply_visitor<MPL::true_>(
+        child_lister<Variant>{children});
+    }
+
+    //counts the nodes of tree, but stops counting at limit
+    template <typename Variant>
+    size_t
+    estimate_size(const Variant& tree, size_t limit)
+    {
+      std::vector<const Variant*> stack{&tree};
+      size_t count = 0;
+
+      while (!stack.empty() && count < limit)
+      {
+        const Variant* v = stack.back();
+        stack.pop_back();
+        ++count;
+        list_children(*v, stack);
+      }
+
+      return count;
+    }
+
+    struct node_address
+    {
+      template <typename T>
+      const void*
+      operator()(const T& t) const
+      {
+        return address(t, is_recursive_wrapper<T>());
+      }
+
+      template <typename T>
+      const void*
+      address(const T&, std::false_type) const
+      {
+        return nullptr;
+      }
+
+      template <typename T>
+      const void*
+      address(const T& t, std::true_type) const
+      {
+        return &recursive_unwrap(t);
+      }
+    };
+
+    //copies made while it is alive are recorded in copies instead
+    class copy_deferral
+    {
+      public:
+
+      explicit
+      copy_deferral(std::vector<deferred_copy>* copies)
+      : m_previous(deferred_copies())
+      {
+        deferred_copies() = copies;
+      }
+
+      ~copy_deferral()
+      {
+        deferred_copies() = m_previous;
+      }
+
+      copy_deferral(const copy_deferral&) = delete;
+
+      copy_deferral&
+      operator=(const copy_deferral&) = delete;
+
+      private:
+      std::vector<deferred_copy>* m_previous;
+    };
+
+    template <typename Variant>
+    class parallel_copier
+    {
+      public:
+
+      parallel_copier(task_pool& pool, size_t grain)
+      : m_group(pool)
+      , m_grain(grain)
+      , m_splits(pool.size() * 16)
+      {
+      }
+
+      //source is the variant that holds the node being copied, or null if
+      //it isn't known
+      void
+      spawn(const Variant* source, deferred_copy copy)
+      {
+        m_group.run([this, source, copy] { run(source, copy); });
+      }
+
+      void
+      wait()
+      {
+        m_group.wait();
+      }
+
+      private:
+
+      void
+      run(const Variant* source, deferred_copy copy) noexcept
+      {
+        if (source == nullptr || estimate_size(*source, m_grain) < m_grain ||
+            !split())
+        {
+          copy_deferral none(nullptr);
+          copy.copy(copy.target, copy.source);
+          return;
+        }
+
+        //the node is copied here, its children by new tasks
+        std::vector<deferred_copy> nested;
+        {
+          copy_deferral deferral(&nested);
+          copy.copy(copy.target, copy.source);
+        }
+
+        std::vector<const Variant*> children;
+        list_children(*source, children);
+
+        //the copies are made in the order of the children unless the copy
+        //constructor of the node copies them in another order, so each
+        //search carries on from the last match
+        size_t next = 0;
+        for (auto& n : nested)
+        {
+          const Variant* child = nullptr;
+          for (size_t i = 0; i != children.size(); ++i)
+          {
+            size_t c = (next + i) % children.size();
+            if (children[c]->template apply_visitor<MPL::true_>(
+                  node_address()) == n.source)
+            {
+              child = children[c];
+              next = c + 1;
+              break;
+            }
+          }
+
+          spawn(child, n);
+        }
+      }
+
+      bool
+      split()
+      {
+        size_t left = m_splits.load();
+        while (left != 0)
+        {
+          if (m_splits.compare_exchange_weak(left, left - 1))
+          {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      task_group m_group;
+      size_t m_grain;
+      std::atomic<size_t> m_splits;
+    };
+
+    template <typename Algebra, typename R>
+    struct combine_step
+    {
+      template <typename T>
+      R
+      operator()(const T& t) const
+      {
+        return combine(t, is_recursive_wrapper<T>());
+      }
+
+      //only nodes are split
+      template <typename T>
+      R
+      combine(const T& t, std::false_type) const
+      {
+        return m_algebra(t);
+      }
+
+      template <typename T>
+      R
+      combine(const T& t, std::true_type) const
+      {
+        return m_algebra(recursive_unwrap(t), m_children);
+      }
+
+      Algebra& m_algebra;
+      fold_results<R> m_children;
+    };
+  }
+
+  template <typename Variant>
+  Variant
+  parallel_copy(const Variant& tree, task_pool& pool = task_pool::global(),
+    size_t grain = parallel_grain)
+  {
+    static_assert(detail::has_parallel_cloner<Variant>::value,
+      "specialise node_cloner<T> as parallel_cloner<T> for a node T of the "
+      "tree, or it is copied on the calling thread");
+
+    grain = std::max<size_t>(grain, 2);
+    if (detail::estimate_size(tree, grain) < grain)
+    {
+      return tree;
+    }
+
+    //the root is allocated here and then copied like any other node
+    std::vector<detail::deferred_copy> root;
+    std::unique_ptr<Variant> result;
+    {
+      detail::copy_deferral deferral(&root);
+      result.reset(new Variant(tree));
+    }
+
+    detail::parallel_copier<Variant> copier(pool, grain);
+    for (auto& r : root)
+    {
+      copier.spawn(&tree, r);
+    }
+    copier.wait();
+
+    return std::move(*result);
+  }
+
+  template <typename Variant, typename Algebra>
+  auto
+  parallel_fold(const Variant& tree, Algebra&& algebra,
+    task_pool& pool = task_pool::global(), size_t grain = parallel_grain)
+  {
+    typedef std::remove_reference_t<Algebra> A;
+    typedef typename detail::fold_result<A, Variant>::type R;
+
+    struct part
+    {
+      const Variant* tree;
+      bool split;
+      size_t first;
+      size_t children;
+    };
+
+    //the tree is split breadth first, so that the children of a part are
+    //next to each other and after it
+    grain = std::max<size_t>(grain, 2);
+    size_t max_parts = pool.size() * 16;
+    std::vector<part> parts{{&tree, false, 0, 0}};
+    std::vector<const Variant*> children;
+
+    for (size_t i = 0; i != parts.size() && parts.size() < max_parts; ++i)
+    {
+      if (detail::estimate_size(*parts[i].tree, grain) < grain)
+      {
+        continue;
+      }
+
+      children.clear();
+      detail::list_children(*parts[i].tree, children);
+
+      parts[i].split = true;
+      parts[i].first = parts.size();
+      parts[i].children = children.size();
+      for (auto c : children)
+      {
+        parts.push_back({c, false, 0, 0});
+      }
+    }
+
+    std::vector<std::unique_ptr<R>> results(parts.size());
+    {
+      task_group group(pool);
+      for (size_t i = 0; i != parts.size(); ++i)
+      {
+        if (!parts[i].split)
+        {
+          group.run([&parts, &results, &algebra, i] {
+            results[i].reset(new R(fold(*parts[i].tree, algebra)));
+          });
+        }
+      }
+      group.wait();
+    }
+
+    std::vector<R> combined;
+    for (size_t i = parts.size(); i-- != 0;)
+    {
+      part& p = parts[i];
+      if (!p.split)
+      {
+        continue;
+      }
+
+      combined.clear();
+      for (size_t c = p.first; c != p.first + p.children; ++c)
+      {
+        combined.push_back(std::move(*results[c]));
+      }
+
+      results[i].reset(new R(p.tree->template apply_visitor<MPL::true_>(
+        detail::combine_step<A, R>{algebra,
+          fold_results<R>(combined.data(), combined.size())})));
+    }
+
+    return std::move(*results.front());
+  }
+}
+
+#endif
@@ -0,0 +1,137 @@
+// Relocating objects, that is moving them to new memory and ending the life
+// of the old object in one step.
+//
+// For most types relocation is the same as copying their bytes, since
+// nothing but the object itself refers to its address. is_trivially_relocatable
+// marks those types, and relocate and uninitialized_relocate use memcpy for
+// them instead of a move constructor and a destructor. It is true for
+// trivially copyable types, and can be specialised for others. A type that
+// keeps a pointer into itself, such as std::string with a short string
+// buffer in libstdc++, must not be marked.
+
+#ifndef JUICE_RELOCATE_HPP_INCLUDED
+#define JUICE_RELOCATE_HPP_INCLUDED
+
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "error.hpp"
+
+namespace juice
+{
+  template <typename T>
+  struct is_trivially_relocatable
+    : public std::integral_constant<bool, std::is_trivially_copyable<T>::value>
+  {
+  };
+
+  template <typename T, typename D>
+  struct is_trivially_relocatable<std::unique_ptr<T, D>>
+    : public is_trivially_relocatable<D> {};
+
+  template <typename T>
+  struct is_trivially_relocatable<std::shared_ptr<T>>
+    : public std::true_type {};
+
+  template <typename T>
+  struct is_trivially_relocatable<const T>
+    : public is_trivially_relocatable<T> {};
+
+  template <typename T, typename U>
+  struct is_trivially_relocatable<std::pair<T, U>>
+    : public std::integral_constant<bool,
+        is_trivially_relocatable<T>::value &&
+        is_trivially_relocatable<U>::value
+      >
+  {
+  };
+
+  namespace detail
+  {
+    template <typename T>
+    void
+    relocate(T* from, T* to, std::true_type)
+    {
+      std::memcpy(static_cast<void*>(to), static_cast<const void*>(from),
+        sizeof(T));
+    }
+
+    template <typename T>
+    void
+    relocate(T* from, T* to, std::false_type)
+    {
+      new (to) T(std::move(*from));
+      from->~T();
+    }
+
+    template <typename T>
+    T*
+    uninitialized_relocate(T* first, T* last, T* out, std::true_type)
+    {
+      size_t n = last - first;
+      if (n != 0)
+      {
+        std::memcpy(static_cast<void*>(out), static_cast<const void*>(first),
+          n * sizeof(T));
+      }
+      return out + n;
+    }
+
+    template <typename T>
+    T*
+    uninitialized_relocate(T* first, T* last, T* out, std::false_type)
+    {
+      //every object is moved before any is destroyed, so if a move throws
+      //the objects that were moved are destroyed and the sources are left
+      //as they were
+      T* current = out;
+      JUICE_TRY
+      {
+        for (T* p = first; p != last; ++p, ++current)
+        {
+          new (current) T(std::move(*p));
+        }
+      }
+      JUICE_CATCH_ALL
+      {
+        for (T* p = out; p != current; ++p)
+        {
+          p->~T();
+        }
+        JUICE_RETHROW;
+      }
+
+      for (T* p = first; p != last; ++p)
+      {
+        p->~T();
+      }
+
+      return current;
+    }
+  }
+
+  //moves *from to the uninitialized memory at to, after which from is
+  //uninitialized memory
+  template <typename T>
+  T*
+  relocate(T* from, T* to)
+  {
+    detail::relocate(from, to, is_trivially_relocatable<T>());
+    return to;
+  }
+
+  //relocates [first, last) to the uninitialized memory at out, which must not
+  //overlap it, and returns the end of the relocated objects
+  template <typename T>
+  T*
+  uninitialized_relocate(T* first, T* last, T* out)
+  {
+    return detail::uninitialized_relocate(first, last, out,
+      is_trivially_relocatable<T>());
+  }
+}
+
+#endif
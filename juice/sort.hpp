@@ -0,0 +1,226 @@
+// Sorting ranges of variants.
+//
+// Variants are ordered by their index first, so sort(range) sorts in two
+// steps. It partitions the range by index with a counting sort, which keeps
+// the order of the variants within each partition, and then sorts each
+// partition with std::sort. Every variant in a partition holds the same
+// alternative, so the comparison only compares that alternative and doesn't
+// look up the alternative of either variant. The result is in the order of
+// operator<, and as with std::sort, equal variants may be reordered.
+//
+// The counting sort relocates each variant to a buffer and then relocates
+// them back, if the variant is trivially relocatable or can't throw when it
+// is moved. Otherwise the partitioning is a std::stable_sort by index, so
+// that a move that throws leaves every variant valid.
+//
+// parallel_sort sorts the partitions at the same time as tasks of a
+// task_pool.
+
+#ifndef JUICE_SORT_HPP_INCLUDED
+#define JUICE_SORT_HPP_INCLUDED
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <memory>
+
+#include "relocate.hpp"
+#include "task_pool.hpp"
+#include "variant.hpp"
+
+namespace juice
+{
+  namespace detail
+  {
+    //valueless variants are less than every other, so they are partition
+    //zero, which the index wraps around to
+    template <typename V>
+    size_t
+    partition_of(const V& v)
+    {
+      return v.index() + 1;
+    }
+
+    template <typename V>
+    struct partition_sorter;
+
+    template <typename... Types>
+    struct partition_sorter<variant<Types...>>
+    {
+      typedef variant<Types...> V;
+
+      static constexpr size_t partitions = sizeof...(Types) + 1;
+
+      //where each partition starts, and the end of the last one
+      typedef std::array<size_t, partitions + 1> bounds;
+
+      template <typename Iterator>
+      static
+      bounds
+      partition(Iterator first, Iterator last)
+      {
+        bounds starts{};
+        bool partitioned = true;
+        size_t previous = 0;
+        for (Iterator it = first; it != last; ++it)
+        {
+          size_t p = partition_of(*it);
+          ++starts[p + 1];
+          partitioned = partitioned && previous <= p;
+          previous = p;
+        }
+
+        for (size_t p = 1; p != starts.size(); ++p)
+        {
+          starts[p] += starts[p - 1];
+        }
+
+        if (!partitioned)
+        {
+          scatter(first, last, starts, std::integral_constant<bool,
+            is_trivially_relocatable<V>::value ||
+            std::is_nothrow_move_constructible<V>::value>());
+        }
+
+        return starts;
+      }
+
+      //sorts [first, last), which is partition p
+      template <typename Iterator>
+      static
+      void
+      sort(size_t p, Iterator first, Iterator last)
+      {
+        sort(p, first, last, std::index_sequence_for<Types...>());
+      }
+
+      private:
+      template <typename Iterator>
+      static
+      void
+      scatter(Iterator first, Iterator last, const bounds& starts,
+        std::true_type)
+      {
+        typedef std::aligned_storage_t<sizeof(V), alignof(V)> storage;
+
+        size_t n = last - first;
+        std::unique_ptr<storage[]> buffer(new storage[n]);
+        V* out = reinterpret_cast<V*>(buffer.get());
+
+        bounds next = starts;
+        for (Iterator it = first; it != last; ++it)
+        {
+          V* v = std::addressof(*it);
+          juice::relocate(v, out + next[partition_of(*v)]++);
+        }
+
+        for (size_t i = 0; i != n; ++i)
+        {
+          juice::relocate(out + i, std::addressof(first[i]));
+        }
+      }
+
+      template <typename Iterator>
+      static
+      void
+      scatter(Iterator first, Iterator last, const bounds&, std::false_type)
+      {
+        std::stable_sort(first, last, [] (const V& a, const V& b) {
+          return partition_of(a) < partition_of(b);
+        });
+      }
+
+      template <size_t I>
+      struct less_at
+      {
+        bool
+        operator()(const V& a, const V& b) const
+        {
+          return three_way(recursive_unwrap(a.template get<I>()),
+            recursive_unwrap(b.template get<I>())) < 0;
+        }
+      };
+
+      template <typename Iterator, size_t... I>
+      static
+      void
+      sort(size_t p, Iterator first, Iterator last, std::index_sequence<I...>)
+      {
+        typedef void (*sorter)(Iterator, Iterator);
+        static constexpr sorter table[] = {
+          &sort_valueless<Iterator>, &sort_at<I, Iterator>...
+        };
+
+        table[p](first, last);
+      }
+
+      //valueless variants are all equal
+      template <typename Iterator>
+      static
+      void
+      sort_valueless(Iterator, Iterator)
+      {
+      }
+
+      template <size_t I, typename Iterator>
+      static
+      void
+      sort_at(Iterator first, Iterator last)
+      {
+        std::sort(first, last, less_at<I>());
+      }
+    };
+
+    template <typename Range>
+    using range_variant_t =
+      std::decay_t<decltype(*std::begin(std::declval<Range&>()))>;
+  }
+
+  //sorts a random access range of variants
+  template <typename Range>
+  void
+  sort(Range& range)
+  {
+    typedef detail::partition_sorter<detail::range_variant_t<Range>> sorter;
+
+    auto first = std::begin(range);
+    auto starts = sorter::partition(first, std::end(range));
+
+    for (size_t p = 1; p != sorter::partitions; ++p)
+    {
+      if (starts[p + 1] - starts[p] > 1)
+      {
+        sorter::sort(p, first + starts[p], first + starts[p + 1]);
+      }
+    }
+  }
+
+  //sorts a random access range of variants, sorting the partitions of each
+  //index at the same time
+  template <typename Range>
+  void
+  parallel_sort(Range& range, task_pool& pool = task_pool::global())
+  {
+    typedef detail::partition_sorter<detail::range_variant_t<Range>> sorter;
+
+    auto first = std::begin(range);
+    auto starts = sorter::partition(first, std::end(range));
+
+    task_group group(pool);
+    for (size_t p = 1; p != sorter::partitions; ++p)
+    {
+      if (starts[p + 1] - starts[p] > 1)
+      {
+        auto begin = first + starts[p];
+        auto end = first + starts[p + 1];
+        group.run([p, begin, end] () {
+          sorter::sort(p, begin, end);
+        });
+      }
+    }
+
+    group.wait();
+  }
+}
+
+#endif
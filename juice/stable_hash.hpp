@@ -0,0 +1,311 @@
+// A hash of a variant that is the same in every build and on every platform.
+//
+// std::hash may change between builds and library versions, so it can't be
+// used to shard data between processes or to persist hash indexes.
+// stable_hash(v) is a 64 bit FNV-1a hash of a fixed encoding of the value:
+//
+//   * integers are eight bytes, little endian, sign extended when signed,
+//   * floating point values are the eight little endian bytes of the
+//     double, with -0.0 hashed as 0.0 and every NaN hashed the same,
+//   * strings are their length and then their characters, which are single
+//     bytes for std::string and integers for wider characters,
+//   * vectors are their length and then their elements,
+//   * a variant is the id of its alternative and then its value.
+//
+// The id of an alternative is its index, unless type_name is specialised
+// for its type, in which case it is the FNV-1a hash of that name. Naming the
+// types keeps the hashes the same when alternatives are added or reordered.
+//
+// Other types are hashed by specialising stable_hasher, whose operator()
+// adds the parts of the value to a stable_hash_state.
+
+#ifndef JUICE_STABLE_HASH_HPP_INCLUDED
+#define JUICE_STABLE_HASH_HPP_INCLUDED
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "variant.hpp"
+
+namespace juice
+{
+  namespace detail
+  {
+    constexpr std::uint64_t fnv_offset = 0xcbf29ce484222325;
+    constexpr std::uint64_t fnv_prime = 0x100000001b3;
+
+    constexpr
+    std::uint64_t
+    fnv1a(const char* s, std::uint64_t h = fnv_offset)
+    {
+      while (*s != 0)
+      {
+        h = (h ^ static_cast<unsigned char>(*s)) * fnv_prime;
+        ++s;
+      }
+      return h;
+    }
+  }
+
+  //specialise with static constexpr const char* value = "name" to give a
+  //type an id that doesn't depend on its index in a variant
+  template <typename T>
+  struct type_name;
+
+  class stable_hash_state
+  {
+    public:
+
+    void
+    add_bytes(const void* bytes, size_t size)
+    {
+      const unsigned char* p = static_cast<const unsigned char*>(bytes);
+      for (size_t i = 0; i != size; ++i)
+      {
+        m_hash = (m_hash ^ p[i]) * detail::fnv_prime;
+      }
+    }
+
+    //adds the eight bytes of u, least significant first
+    void
+    add(std::uint64_t u)
+    {
+      for (int i = 0; i != 8; ++i)
+      {
+        m_hash = (m_hash ^ ((u >> (i * 8)) & 0xff)) * detail::fnv_prime;
+      }
+    }
+
+    std::uint64_t value() const { return m_hash; }
+
+    private:
+    std::uint64_t m_hash = detail::fnv_offset;
+  };
+
+  template <typename T, typename = void>
+  struct stable_hasher;
+
+  template <typename T>
+  struct stable_hasher<T, std::enable_if_t<std::is_integral<T>::value>>
+  {
+    void
+    operator()(stable_hash_state& state, T t) const
+    {
+      add(state, t, std::is_signed<T>());
+    }
+
+    private:
+    static
+    void
+    add(stable_hash_state& state, T t, std::true_type)
+    {
+      state.add(static_cast<std::uint64_t>(static_cast<std::int64_t>(t)));
+    }
+
+    static
+    void
+    add(stable_hash_state& state, T t, std::false_type)
+    {
+      state.add(static_cast<std::uint64_t>(t));
+    }
+  };
+
+  //char is signed on some platforms and not on others
+  template <>
+  struct stable_hasher<char>
+  {
+    void
+    operator()(stable_hash_state& state, char c) const
+    {
+      state.add(static_cast<unsigned char>(c));
+    }
+  };
+
+  template <typename T>
+  struct stable_hasher<T, std::enable_if_t<std::is_enum<T>::value>>
+  {
+    void
+    operator()(stable_hash_state& state, T t) const
+    {
+      typedef std::underlying_type_t<T> U;
+      stable_hasher<U>()(state, static_cast<U>(t));
+    }
+  };
+
+  template <typename T>
+  struct stable_hasher<T, std::enable_if_t<std::is_floating_point<T>::value>>
+  {
+    void
+    operator()(stable_hash_state& state, T t) const
+    {
+      static_assert(std::numeric_limits<double>::is_iec559,
+        "doubles must be IEEE 754");
+
+      double d = t;
+      if (d == 0)
+      {
+        d = 0;
+      }
+      else if (std::isnan(d))
+      {
+        d = std::numeric_limits<double>::quiet_NaN();
+      }
+
+      std::uint64_t bits;
+      std::memcpy(&bits, &d, sizeof(bits));
+      state.add(bits);
+    }
+  };
+
+  template <typename Char, typename Traits, typename Allocator>
+  struct stable_hasher<std::basic_string<Char, Traits, Allocator>>
+  {
+    void
+    operator()(stable_hash_state& state,
+      const std::basic_string<Char, Traits, Allocator>& s) const
+    {
+      state.add(s.size());
+      add(state, s, std::is_same<Char, char>());
+    }
+
+    private:
+    static
+    void
+    add(stable_hash_state& state,
+      const std::basic_string<Char, Traits, Allocator>& s, std::true_type)
+    {
+      state.add_bytes(s.data(), s.size());
+    }
+
+    static
+    void
+    add(stable_hash_state& state,
+      const std::basic_string<Char, Traits, Allocator>& s, std::false_type)
+    {
+      for (Char c : s)
+      {
+        stable_hasher<Char>()(state, c);
+      }
+    }
+  };
+
+  template <typename T, typename Allocator>
+  struct stable_hasher<std::vector<T, Allocator>>
+  {
+    void
+    operator()(stable_hash_state& state,
+      const std::vector<T, Allocator>& v) const
+    {
+      state.add(v.size());
+      for (const auto& t : v)
+      {
+        stable_hasher<T>()(state, t);
+      }
+    }
+  };
+
+  template <>
+  struct stable_hasher<monostate>
+  {
+    void
+    operator()(stable_hash_state&, const monostate&) const
+    {
+    }
+  };
+
+  template <typename T>
+  struct stable_hasher<recursive_wrapper<T>>
+  {
+    void
+    operator()(stable_hash_state& state, const recursive_wrapper<T>& r) const
+    {
+      stable_hasher<T>()(state, r.get());
+    }
+  };
+
+  namespace detail
+  {
+    template <typename T, typename = const char*>
+    struct has_type_name : public std::false_type {};
+
+    template <typename T>
+    struct has_type_name<T, std::decay_t<decltype(type_name<T>::value)>>
+      : public std::true_type {};
+
+    template <typename T, size_t I>
+    constexpr
+    std::uint64_t
+    type_id(std::true_type)
+    {
+      return fnv1a(type_name<T>::value);
+    }
+
+    template <typename T, size_t I>
+    constexpr
+    std::uint64_t
+    type_id(std::false_type)
+    {
+      return I;
+    }
+  }
+
+  //the id that the I-th alternative of a variant is hashed with
+  template <typename T, size_t I>
+  constexpr std::uint64_t stable_type_id_v =
+    detail::type_id<unwrapped_type_t<T>, I>(
+      detail::has_type_name<unwrapped_type_t<T>>());
+
+  template <typename... Types>
+  struct stable_hasher<variant<Types...>>
+  {
+    void
+    operator()(stable_hash_state& state, const variant<Types...>& v) const
+    {
+      if (v.valueless_by_exception())
+      {
+        state.add(std::numeric_limits<std::uint64_t>::max());
+        return;
+      }
+
+      add(state, v, std::index_sequence_for<Types...>());
+    }
+
+    private:
+    template <size_t... I>
+    static
+    void
+    add(stable_hash_state& state, const variant<Types...>& v,
+      std::index_sequence<I...>)
+    {
+      typedef void (*adder)(stable_hash_state&, const variant<Types...>&);
+      static constexpr adder table[] = {&add_at<I>...};
+
+      table[v.index()](state, v);
+    }
+
+    template <size_t I>
+    static
+    void
+    add_at(stable_hash_state& state, const variant<Types...>& v)
+    {
+      typedef std::tuple_element_t<I, variant<Types...>> T;
+      state.add(stable_type_id_v<T, I>);
+      stable_hasher<std::decay_t<T>>()(state, v.template get<I>());
+    }
+  };
+
+  template <typename T>
+  std::uint64_t
+  stable_hash(const T& t)
+  {
+    stable_hash_state state;
+    stable_hasher<T>()(state, t);
+    return state.value();
+  }
+}
+
+#endif
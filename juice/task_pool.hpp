@@ -0,0 +1,325 @@
+// A small work stealing thread pool.
+//
+// Every worker has its own queue. A task submitted from a worker goes on the
+// back of that worker's queue, and the worker takes its own tasks from the
+// back, so a task that splits its work keeps the pieces close to it. A
+// worker that runs out of tasks steals from the front of the other queues,
+// which is where the oldest and usually largest pieces of work are.
+//
+// A task_group runs tasks on a pool and waits for them. A thread that waits
+// for a group runs queued tasks while it waits, so groups can be waited on
+// from inside tasks without running out of threads.
+
+#ifndef JUICE_TASK_POOL_HPP_INCLUDED
+#define JUICE_TASK_POOL_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "error.hpp"
+
+namespace juice
+{
+  class task_pool
+  {
+    public:
+
+    typedef std::function<void()> task;
+
+    explicit
+    task_pool(size_t threads = default_threads())
+    : m_queued(0)
+    , m_next(0)
+    , m_stop(false)
+    {
+      threads = std::max<size_t>(threads, 1);
+      for (size_t i = 0; i != threads; ++i)
+      {
+        m_queues.emplace_back(new queue);
+      }
+
+      for (size_t i = 0; i != threads; ++i)
+      {
+        m_threads.emplace_back([this, i] { work(i); });
+      }
+    }
+
+    ~task_pool()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_sleep);
+        m_stop = true;
+      }
+      m_wake.notify_all();
+
+      for (auto& t : m_threads)
+      {
+        t.join();
+      }
+    }
+
+    task_pool(const task_pool&) = delete;
+
+    task_pool&
+    operator=(const task_pool&) = delete;
+
+    //a pool with a thread for every core, started the first time it is used
+    static
+    task_pool&
+    global()
+    {
+      static task_pool pool;
+      return pool;
+    }
+
+    size_t size() const { return m_threads.size(); }
+
+    void
+    submit(task t)
+    {
+      size_t i = self().pool == this ? self().index
+        : m_next.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+
+      {
+        std::lock_guard<std::mutex> lock(m_queues[i]->mutex);
+        m_queues[i]->tasks.push_back(std::move(t));
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_sleep);
+        ++m_queued;
+      }
+      m_wake.notify_one();
+    }
+
+    //runs one queued task on the calling thread, returns false if there was
+    //nothing to run
+    bool
+    run_one()
+    {
+      task t;
+      if (!take(self().pool == this ? self().index : 0, t))
+      {
+        return false;
+      }
+
+      t();
+      return true;
+    }
+
+    //blocks until a task is queued or done() is true. done is called with
+    //a lock held that wake_all takes too, so whatever makes it true must be
+    //followed by wake_all.
+    template <typename Done>
+    void
+    wait_for_task(Done done)
+    {
+      std::unique_lock<std::mutex> lock(m_sleep);
+      m_wake.wait(lock, [this, &done] { return m_queued != 0 || done(); });
+    }
+
+    void
+    wake_all()
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_sleep);
+      }
+      m_wake.notify_all();
+    }
+
+    private:
+
+    struct queue
+    {
+      std::mutex mutex;
+      std::deque<task> tasks;
+    };
+
+    struct worker
+    {
+      task_pool* pool;
+      size_t index;
+    };
+
+    static
+    size_t
+    default_threads()
+    {
+      return std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    static
+    worker&
+    self()
+    {
+      static thread_local worker w{nullptr, 0};
+      return w;
+    }
+
+    //takes the newest task of queue i, or steals the oldest task of another
+    bool
+    take(size_t i, task& t)
+    {
+      for (size_t n = 0; n != m_queues.size(); ++n)
+      {
+        queue& q = *m_queues[(i + n) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (q.tasks.empty())
+        {
+          continue;
+        }
+
+        if (n == 0)
+        {
+          t = std::move(q.tasks.back());
+          q.tasks.pop_back();
+        }
+        else
+        {
+          t = std::move(q.tasks.front());
+          q.tasks.pop_front();
+        }
+
+        std::lock_guard<std::mutex> sleep(m_sleep);
+        --m_queued;
+        return true;
+      }
+
+      return false;
+    }
+
+    void
+    work(size_t i)
+    {
+      self() = worker{this, i};
+
+      while (true)
+      {
+        task t;
+        if (take(i, t))
+        {
+          t();
+          continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleep);
+        m_wake.wait(lock, [this] { return m_stop || m_queued != 0; });
+        if (m_stop && m_queued == 0)
+        {
+          return;
+        }
+      }
+    }
+
+    std::vector<std::unique_ptr<queue>> m_queues;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_sleep;
+    std::condition_variable m_wake;
+    size_t m_queued;
+
+    std::atomic<size_t> m_next;
+    bool m_stop;
+  };
+
+  class task_group
+  {
+    public:
+
+    explicit
+    task_group(task_pool& pool = task_pool::global())
+    : m_pool(pool)
+    , m_pending(0)
+    {
+    }
+
+    //tasks refer to the group, so it waits for them even if wait was not
+    //called because of an exception
+    ~task_group()
+    {
+      JUICE_TRY
+      {
+        wait();
+      }
+      JUICE_CATCH_ALL
+      {
+      }
+    }
+
+    task_group(const task_group&) = delete;
+
+    task_group&
+    operator=(const task_group&) = delete;
+
+    template <typename F>
+    void
+    run(F&& f)
+    {
+      m_pending.fetch_add(1);
+      m_pool.submit([this, pool = &m_pool, f = std::forward<F>(f)] ()
+        mutable {
+        JUICE_TRY
+        {
+          f();
+        }
+        JUICE_CATCH_ALL
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          if (!m_error)
+          {
+            m_error = std::current_exception();
+          }
+        }
+        //the group can be gone as soon as the count reaches zero
+        if (m_pending.fetch_sub(1) == 1)
+        {
+          pool->wake_all();
+        }
+      });
+    }
+
+    //waits for every task of the group, and rethrows the first exception
+    //that one of them threw. It runs queued tasks while there are any, and
+    //sleeps when there are none.
+    void
+    wait()
+    {
+      while (m_pending.load() != 0)
+      {
+        if (!m_pool.run_one())
+        {
+          m_pool.wait_for_task([this] { return m_pending.load() == 0; });
+        }
+      }
+
+      std::exception_ptr error;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        error = std::move(m_error);
+        m_error = nullptr;
+      }
+
+      if (error)
+      {
+        std::rethrow_exception(error);
+      }
+    }
+
+    private:
+    task_pool& m_pool;
+    std::atomic<size_t> m_pending;
+    std::mutex m_mutex;
+    std::exception_ptr m_error;
+  };
+}
+
+#endif
@@ -0,0 +1,59 @@
+// Binding an object to the current thread.
+//
+// The arenas of arena_wrapper and offset_wrapper are found through the
+// thread, since a node has no room to point at its arena. A type T derives
+// from thread_bound<T>, which gives it a scope that binds a T to the current
+// thread, and bound(), the T that is bound now or null.
+
+#ifndef JUICE_THREAD_BINDING_HPP_INCLUDED
+#define JUICE_THREAD_BINDING_HPP_INCLUDED
+
+namespace juice
+{
+  namespace detail
+  {
+    template <typename T>
+    class thread_bound
+    {
+      public:
+
+      //binds a T to the current thread for the lifetime of the scope, and
+      //then binds whatever was bound before
+      class scope
+      {
+        public:
+        explicit
+        scope(T& t)
+        : m_previous(bound())
+        {
+          bound() = &t;
+        }
+
+        ~scope()
+        {
+          bound() = m_previous;
+        }
+
+        scope(const scope&) = delete;
+
+        scope&
+        operator=(const scope&) = delete;
+
+        private:
+        T* m_previous;
+      };
+
+      protected:
+
+      static
+      T*&
+      bound()
+      {
+        static thread_local T* t = nullptr;
+        return t;
+      }
+    };
+  }
+}
+
+#endif
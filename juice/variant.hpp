@@ -46,7 +46,10 @@ do so, all subject to the following:
 // the visitor.
 //
 // == Notes ==
-// Hash is not yet implemented.
+// std::hash is specialised for variant as basic_variant_hash, which combines
+// a seed for the index with the hash of the value, so it doesn't need RTTI.
+// basic_variant_hash takes the hasher for the values as a parameter, for
+// example mix_hasher, and juice/variant_hash.hpp adds heterogeneous lookup.
 // Some of the visitors have operator()() lying around from trying a previous
 // proposal with empty visitation.
 
@@ -54,17 +57,26 @@ do so, all subject to the following:
 #ifndef JUICE_VARIANT_HPP_INCLUDED
 #define JUICE_VARIANT_HPP_INCLUDED
 
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <stdexcept>
+#include <string>
 #include <functional>
 #include <initializer_list>
 #include <new>
-#include <typeindex>
 #include <type_traits>
 #include <utility>
 
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
 #include "conjunction.hpp"
+#include "error.hpp"
 #include "mpl.hpp"
+#include "relocate.hpp"
 #include "tuple.hpp"
 
 namespace juice
@@ -79,6 +91,8 @@ namespace juice
   template <typename T> constexpr emplaced_type_t<T> emplaced_type{};
   template <size_t I> struct emplaced_index_t {};
   template <size_t I> constexpr emplaced_index_t<I> emplaced_index{};
+  template <size_t I> struct emplaced_with_t {};
+  template <size_t I> constexpr emplaced_with_t<I> emplaced_with{};
 
   template <typename R = void>
   class
@@ -93,9 +107,114 @@ namespace juice
     ~static_visitor() = default;
   };
 
+  //allocates the copy of a node for the copy constructor of
+  //recursive_wrapper<T>. It can be specialised, parallel.hpp has one that
+  //lets parallel_copy copy the subtrees of T on other threads.
+  template <typename T>
+  struct node_cloner
+  {
+    static
+    T*
+    clone(const T& t)
+    {
+      return new T(t);
+    }
+  };
+
+  //specialise as std::true_type for a type T to keep the std::hash of T in
+  //each recursive_wrapper<T>, so that a tree whose nodes all cache their
+  //hashes is only hashed again below the nodes that were changed, and two
+  //trees with different cached hashes compare unequal straight away. The
+  //cache is cleared by anything that can change the node, which includes
+  //the non-const get(). A reference to the node that is kept from before the
+  //hash was taken must not be used to change it.
+  template <typename T>
+  struct is_hash_cached : public std::false_type {};
+
+  namespace detail
+  {
+    template <bool Cached>
+    class node_hash
+    {
+      protected:
+      template <typename T>
+      size_t
+      cached_hash(const T& t) const
+      {
+        return std::hash<T>()(t);
+      }
+
+      bool
+      hashes_differ(const node_hash&) const
+      {
+        return false;
+      }
+
+      void
+      reset_hash()
+      {
+      }
+    };
+
+    //zero is not cached, so that a node with no hash yet needs no flag
+    template <>
+    class node_hash<true>
+    {
+      protected:
+      node_hash() = default;
+
+      node_hash(const node_hash& rhs)
+      : m_hash(rhs.m_hash.load(std::memory_order_relaxed))
+      {
+      }
+
+      node_hash&
+      operator=(const node_hash& rhs)
+      {
+        m_hash.store(rhs.m_hash.load(std::memory_order_relaxed),
+          std::memory_order_relaxed);
+        return *this;
+      }
+
+      //threads hashing the same node at once store the same value
+      template <typename T>
+      size_t
+      cached_hash(const T& t) const
+      {
+        size_t h = m_hash.load(std::memory_order_relaxed);
+        if (h == 0)
+        {
+          h = std::hash<T>()(t);
+          m_hash.store(h, std::memory_order_relaxed);
+        }
+        return h;
+      }
+
+      bool
+      hashes_differ(const node_hash& rhs) const
+      {
+        size_t h = m_hash.load(std::memory_order_relaxed);
+        size_t r = rhs.m_hash.load(std::memory_order_relaxed);
+        return h != 0 && r != 0 && h != r;
+      }
+
+      void
+      reset_hash()
+      {
+        m_hash.store(0, std::memory_order_relaxed);
+      }
+
+      private:
+      mutable std::atomic<size_t> m_hash{0};
+    };
+  }
+
   template <typename T>
   class recursive_wrapper
+    : private detail::node_hash<is_hash_cached<T>::value>
   {
+    typedef detail::node_hash<is_hash_cached<T>::value> node_hash;
+
     public:
     ~recursive_wrapper()
     {
@@ -124,10 +243,12 @@ namespace juice
     : m_t(new T(std::forward<U>(u))) { }
 
     recursive_wrapper(const recursive_wrapper& rhs)
-    : m_t(new T(rhs.get())) { }
+    : node_hash(rhs)
+    , m_t(node_cloner<T>::clone(rhs.get())) { }
 
-    recursive_wrapper(recursive_wrapper&& rhs)
-    : m_t(rhs.m_t)
+    recursive_wrapper(recursive_wrapper&& rhs) noexcept
+    : node_hash(rhs)
+    , m_t(rhs.m_t)
     {
       rhs.m_t = nullptr;
     }
@@ -136,17 +257,19 @@ namespace juice
     operator=(const recursive_wrapper& rhs)
     {
       assign(rhs.get());
+      node_hash::operator=(rhs);
       return *this;
     }
 
     recursive_wrapper&
-    operator=(recursive_wrapper&& rhs)
+    operator=(recursive_wrapper&& rhs) noexcept
     {
       if (this != &rhs)
       {
         const T* tmp = m_t;
         m_t = rhs.m_t;
         rhs.m_t = nullptr;
+        node_hash::operator=(rhs);
         delete tmp;
       }
       return *this;
@@ -169,20 +292,47 @@ namespace juice
     bool
     operator==(const recursive_wrapper& rhs) const
     {
+      if (this->hashes_differ(rhs))
+      {
+        return false;
+      }
+
       return *m_t == *rhs.m_t;
     }
 
-    T& get() { return *m_t; }
+    T&
+    get()
+    {
+      this->reset_hash();
+      return *m_t;
+    }
+
     const T& get() const { return *m_t; }
 
+    //the std::hash of the node, which is kept if is_hash_cached<T>
+    size_t
+    hash() const
+    {
+      return this->cached_hash(*m_t);
+    }
+
     private:
     T* m_t;
 
+    //a wrapper that has been moved from has no node, and gets a new one
     template <typename U>
     void
     assign(U&& u)
     {
-      *m_t = std::forward<U>(u);
+      this->reset_hash();
+      if (m_t == nullptr)
+      {
+        m_t = new T(std::forward<U>(u));
+      }
+      else
+      {
+        *m_t = std::forward<U>(u);
+      }
     }
   };
 
@@ -193,6 +343,11 @@ namespace juice
   struct is_recursive_wrapper<recursive_wrapper<T>>
     : public std::true_type {};
 
+  //a recursive_wrapper is only a pointer to its node
+  template <typename T>
+  struct is_trivially_relocatable<recursive_wrapper<T>>
+    : public std::true_type {};
+
   template <typename T>
   struct unwrapped_type
   {
@@ -256,18 +411,20 @@ namespace juice
       return t;
     }
 
-    template <typename T>
-    T&
-    get_value(recursive_wrapper<T>& t, const MPL::false_&)
-    {
-      return t.get();
-    }
-
-    template <typename T>
-    const T&
-    get_value(const recursive_wrapper<T>& t, const MPL::false_&)
+    //wrappers are unwrapped through an unqualified call to recursive_unwrap,
+    //so that wrappers declared after this header are found by argument
+    //dependent lookup, they only need to specialise is_recursive_wrapper
+    template
+    <
+      typename T,
+      typename = std::enable_if_t<
+        is_recursive_wrapper<std::remove_const_t<T>>::value
+      >
+    >
+    decltype(auto)
+    get_value(T& t, const MPL::false_&)
     {
-      return t.get();
+      return recursive_unwrap(t);
     }
 
     template <typename Visitor, typename Visitable>
@@ -295,25 +452,50 @@ namespace juice
       Visitable& visitable;
     };
 
-    struct
-    swapper
+    namespace swap_lookup
     {
+      using std::swap;
+
+      template <typename T, typename = void>
+      struct nothrow_swappable : public std::false_type {};
+
       template <typename T>
-      void
-      operator()(T& t, T& rhs)
+      struct nothrow_swappable<T,
+        decltype(swap(std::declval<T&>(), std::declval<T&>()))>
+        : public std::integral_constant<bool,
+            noexcept(swap(std::declval<T&>(), std::declval<T&>()))
+          >
       {
-        std::swap(t, rhs);
-      }
+      };
 
-      template <typename T, typename U>
+      template <typename T>
       void
-      operator()(T&, U&)
+      swap_values(void* a, void* b)
       {
-        //this should never be called
-        assert(false);
+        swap(*static_cast<T*>(a), *static_cast<T*>(b));
       }
+    }
+
+    template <typename... MyTypes>
+    struct assign_FUN
+    {
+      static void FUN();
+    };
+
+    template <typename Current, typename... MyTypes>
+    struct assign_FUN<Current, MyTypes...> : public assign_FUN<MyTypes...>
+    {
+      using assign_FUN<MyTypes...>::FUN;
+
+      static Current
+      FUN(Current);
     };
 
+    //the alternative that constructing or assigning from a T chooses
+    template <typename T, typename... Types>
+    using assigned_alternative_t =
+      decltype(assign_FUN<Types...>::FUN(std::declval<T>()));
+
     template <typename T, typename... Types>
     struct variant_universal_check
     {
@@ -323,6 +505,68 @@ namespace juice
       ;
     };
 
+    template <typename T, typename U, typename = bool>
+    struct equality_comparable : public std::false_type {};
+
+    template <typename T, typename U>
+    struct equality_comparable<T, U,
+      decltype(std::declval<const T&>() == std::declval<const U&>())>
+      : public std::true_type {};
+
+    //the first of Types that can be compared with a T
+    template <size_t N, typename T, typename... Types>
+    struct first_comparable
+      : public std::integral_constant<size_t, tuple_not_found> {};
+
+    template <size_t N, typename T, typename First, typename... Types>
+    struct first_comparable<N, T, First, Types...>
+      : public std::conditional_t<
+          equality_comparable<unwrapped_type_t<First>, T>::value,
+          std::integral_constant<size_t, N>,
+          first_comparable<N + 1, T, Types...>
+        >
+    {
+    };
+
+    template <typename T, typename Types, typename = void>
+    struct assigned_index
+      : public std::integral_constant<size_t, tuple_not_found> {};
+
+    template <typename T, typename... Types>
+    struct assigned_index<T, std::tuple<Types...>,
+      decltype(void(assign_FUN<Types...>::FUN(std::declval<const T&>())))>
+      : public tuple_find<
+          assigned_alternative_t<const T&, Types...>, std::tuple<Types...>
+        >
+    {
+    };
+
+    template <typename T, typename Types, size_t Exact, size_t Assigned>
+    struct compared_index_helper
+      : public std::integral_constant<size_t, Exact> {};
+
+    template <typename T, typename... Types, size_t Assigned>
+    struct compared_index_helper<T, std::tuple<Types...>, tuple_not_found,
+      Assigned>
+      : public std::integral_constant<size_t, Assigned> {};
+
+    template <typename T, typename... Types>
+    struct compared_index_helper<T, std::tuple<Types...>, tuple_not_found,
+      tuple_not_found>
+      : public first_comparable<0, T, Types...> {};
+
+    //the alternative that a T is compared with: the one of the same type,
+    //or else the one that assigning a T would choose, or else the first one
+    //that can be compared with a T, such as std::string for a string_view
+    template <typename T, typename... Types>
+    struct compared_index
+      : public compared_index_helper<T, std::tuple<Types...>,
+          tuple_find<T, std::tuple<Types...>>::value,
+          assigned_index<T, std::tuple<Types...>>::value
+        >
+    {
+    };
+
   }    
 
   struct monostate {};
@@ -424,11 +668,123 @@ namespace juice
   template <typename T>
   using ref_type_t = typename ref_type<T>::type;
 
+  //specialise as std::true_type for a type T whose a.compare(b) returns less
+  //than, equal to or greater than zero as operator< orders a and b, so that
+  //comparing variants that hold a T takes one pass instead of two. A compare
+  //member that means something else is not used unless the type is marked.
+  template <typename T>
+  struct has_three_way_compare : public std::false_type {};
+
+  template <typename Char, typename Traits, typename Allocator>
+  struct has_three_way_compare<std::basic_string<Char, Traits, Allocator>>
+    : public std::true_type {};
+
+#if __cplusplus >= 201703L
+  template <typename Char, typename Traits>
+  struct has_three_way_compare<std::basic_string_view<Char, Traits>>
+    : public std::true_type {};
+#endif
+
+  namespace detail
+  {
+    template <typename T>
+    int
+    three_way(const T& a, const T& b, std::true_type)
+    {
+      int c = a.compare(b);
+      return (c > 0) - (c < 0);
+    }
+
+    template <typename T>
+    int
+    three_way(const T& a, const T& b, std::false_type)
+    {
+      return a < b ? -1 : (b < a ? 1 : 0);
+    }
+
+    //compares two values with their compare member if has_three_way_compare
+    //marks it, and with operator< otherwise
+    template <typename T>
+    int
+    three_way(const T& a, const T& b)
+    {
+      return three_way(a, b, has_three_way_compare<T>());
+    }
+
+    template <typename T>
+    struct storage_size
+    {
+      static constexpr size_t value = sizeof(ref_type_t<T>);
+    };
+
+    template <typename T>
+    struct storage_align
+    {
+      static constexpr size_t value = alignof(ref_type_t<T>);
+    };
+
+    //the storage of a variant is separate so that a variant can be
+    //trivially destructible when all of its types are
+    template <bool Trivial, typename... Types>
+    struct variant_storage
+    {
+      typename std::aligned_storage<
+        max<storage_size, Types...>::value,
+        max<storage_align, Types...>::value
+      >::type m_storage;
+
+      //a variant that fails to construct is destroyed as empty
+      size_t m_which = tuple_not_found;
+    };
+
+    template <typename... Types>
+    struct variant_storage<false, Types...>
+    {
+      ~variant_storage()
+      {
+        typedef void (*destroyer)(void*);
+        static constexpr destroyer destroyers[] = {&destroy<Types>...};
+
+        if (m_which != tuple_not_found)
+        {
+          destroyers[m_which](&m_storage);
+        }
+      }
+
+      template <typename T>
+      static
+      void
+      destroy(void* storage)
+      {
+        static_cast<ref_type_t<T>*>(storage)->~ref_type_t<T>();
+      }
+
+      typename std::aligned_storage<
+        max<storage_size, Types...>::value,
+        max<storage_align, Types...>::value
+      >::type m_storage;
+
+      size_t m_which = tuple_not_found;
+    };
+
+    template <typename... Types>
+    using variant_storage_t = variant_storage<
+      conjunction<
+        std::is_trivially_destructible<ref_type_t<Types>>::value...
+      >::value,
+      Types...
+    >;
+  }
+
   template <typename... Types>
-  class variant
+  class variant : private detail::variant_storage_t<Types...>
   {
     private:
 
+    typedef detail::variant_storage_t<Types...> storage;
+    using storage::m_storage;
+    using storage::m_which;
+
     typedef typename detail::pack_first<Types...>::type First;
 
     template <typename... AllTypes>
@@ -486,26 +842,6 @@ namespace juice
       }
     };
 
-    template <typename T>
-    struct Sizeof
-    {
-      static constexpr size_t value = sizeof(T);
-    };
-
-    template <typename T>
-    struct Alignof
-    {
-      static constexpr size_t value = alignof(T);
-    };
-
-    //size = max of size of each thing
-    static constexpr size_t m_size = 
-      max
-      <
-        Sizeof,
-        Types...
-      >::value;
-
     struct constructor
     {
       constructor(variant& self)
@@ -662,6 +998,26 @@ namespace juice
       const variant& m_self;
     };
 
+    struct three_way_comparer
+    {
+      three_way_comparer(const variant& self)
+      : m_self(self)
+      {
+      }
+
+      template <typename Rhs>
+      int
+      operator()(Rhs& rhs) const
+      {
+        return detail::three_way(
+          recursive_unwrap(*reinterpret_cast<Rhs*>(m_self.address())),
+          recursive_unwrap(rhs));
+      }
+
+      private:
+      const variant& m_self;
+    };
+
     struct destroyer
     {
       void
@@ -678,20 +1034,8 @@ namespace juice
       }
     };
 
-    template <typename... MyTypes>
-    struct assign_FUN
-    {
-      static void FUN();
-    };
-
-    template <typename Current, typename... MyTypes>
-    struct assign_FUN<Current, MyTypes...> : public assign_FUN<MyTypes...>
-    {
-      using assign_FUN<MyTypes...>::FUN;
-
-      static Current
-      FUN(Current);
-    };
+    template <typename T>
+    using assigned_type = detail::assigned_alternative_t<T, Types...>;
 
     template <size_t Which, typename... MyTypes>
     struct initialiser;
@@ -813,14 +1157,9 @@ namespace juice
       >::type* = nullptr
     )
     noexcept(std::is_nothrow_default_constructible<First>::value)
-    : m_which(0)
     {
       emplace_internal<First>();
-    }
-
-    ~variant()
-    {
-      destroy();
+      indicate_which(0);
     }
 
     //enable_if disables this function if we are constructing with a variant.
@@ -846,7 +1185,7 @@ namespace juice
       //any of the types in (First, Types...)
       //initialiser<0, Types...>::initialise(*this, std::forward<T>(t));
 
-      typedef decltype(assign_FUN<Types...>::FUN(std::forward<T>(t))) type;
+      typedef assigned_type<T> type;
       constexpr auto I = tuple_find_v<type, variant>;
 
       construct<type>(std::forward<T>(t));
@@ -855,7 +1194,10 @@ namespace juice
 
     variant(const variant& rhs)
     {
-      rhs.apply_visitor_internal(constructor(*this));
+      if (!rhs.valueless_by_exception())
+      {
+        rhs.apply_visitor_internal(constructor(*this));
+      }
       indicate_which(rhs.which());
     }
 
@@ -866,7 +1208,10 @@ namespace juice
     {
       //this does not invalidate rhs, it moves the value in rhs to this,
       //which leaves an empty but valid value in rhs
-      rhs.apply_visitor_internal(move_constructor(*this));
+      if (!rhs.valueless_by_exception())
+      {
+        rhs.apply_visitor_internal(move_constructor(*this));
+      }
       indicate_which(rhs.which());
     }
 
@@ -910,33 +1255,130 @@ namespace juice
       indicate_which(I);
     }
 
+    //constructs alternative I from the value returned by f(), which is
+    //created directly in the variant
+    template <size_t I, typename F>
+    variant(emplaced_with_t<I>, F&& f)
+    {
+      new (&m_storage) ref_type_t<std::tuple_element_t<I, variant>>(
+        std::forward<F>(f)());
+      indicate_which(I);
+    }
+
     template <typename T, typename... Args>
     void emplace(Args&&... args)
     {
       return emplace<tuple_find<T, variant>::value>(std::forward<Args>(args)...);
     }
 
-    template <typename T, typename U, typename... Args>
-    void emplace(std::initializer_list<U> il, Args&&... args)
+    //f must not refer to the value of the variant, which is destroyed before
+    //f is called
+    template <size_t I, typename F>
+    void
+    emplace_with(F&& f)
     {
-      return emplace<tuple_find<T, variant>::value>(
-        il,
-        std::forward<Args>(args)...
-      );
+      destroy();
+      new (&m_storage) ref_type_t<std::tuple_element_t<I, variant>>(
+        std::forward<F>(f)());
+      indicate_which(I);
     }
 
-    template <size_t I, typename... Args>
-    void emplace(Args&&... args)
+    template <typename T, typename F>
+    void
+    emplace_with(F&& f)
     {
-      if (!valueless_by_exception())
-      {
-        destroy();
-      }
-      emplace_internal<typename std::tuple_element<I, variant>::type>(std::forward<Args>(args)...);
-      indicate_which(I);
+      emplace_with<tuple_find<T, variant>::value>(std::forward<F>(f));
     }
 
-    template <size_t I, typename U, typename... Args>
+    //moves the value out and leaves the variant valueless, so that its
+    //destructor has nothing left to do. The moved from value still has its
+    //destructor run, but directly, because its type is known here, and not
+    //through the destroyer table. Use extract_to to skip the destructor.
+    template <size_t I>
+    std::tuple_element_t<I, variant>
+    extract()
+    {
+      using R = ref_type_t<std::tuple_element_t<I, variant>>;
+
+      struct destroy_moved
+      {
+        ~destroy_moved()
+        {
+          value.~R();
+        }
+
+        R& value;
+      };
+
+      if (index() != I)
+      {
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
+      }
+
+      destroy_moved moved{reinterpret_cast<R&>(m_storage)};
+      indicate_which(tuple_not_found);
+      return std::move(moved.value);
+    }
+
+    template <typename T>
+    T
+    extract()
+    {
+      return extract<tuple_find<T, variant>::value>();
+    }
+
+    //relocates the value into the uninitialized memory at out and leaves the
+    //variant valueless. For a trivially relocatable alternative this is a
+    //memcpy and no destructor is run at all.
+    template <size_t I>
+    std::tuple_element_t<I, variant>*
+    extract_to(void* out)
+    {
+      using E = std::tuple_element_t<I, variant>;
+      static_assert(!std::is_reference<E>::value,
+        "A reference can't be relocated, use extract");
+
+      if (index() != I)
+      {
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
+      }
+
+      E* result = relocate(reinterpret_cast<E*>(&m_storage),
+        static_cast<E*>(out));
+      indicate_which(tuple_not_found);
+      return result;
+    }
+
+    template <typename T>
+    T*
+    extract_to(void* out)
+    {
+      return extract_to<tuple_find<T, variant>::value>(out);
+    }
+
+    template <typename T, typename U, typename... Args>
+    void emplace(std::initializer_list<U> il, Args&&... args)
+    {
+      return emplace<tuple_find<T, variant>::value>(
+        il,
+        std::forward<Args>(args)...
+      );
+    }
+
+    template <size_t I, typename... Args>
+    void emplace(Args&&... args)
+    {
+      if (!valueless_by_exception())
+      {
+        destroy();
+      }
+      emplace_internal<typename std::tuple_element<I, variant>::type>(std::forward<Args>(args)...);
+      indicate_which(I);
+    }
+
+    template <size_t I, typename U, typename... Args>
     void emplace(std::initializer_list<U> il, Args&&... args)
     {
       if (!valueless_by_exception())
@@ -951,8 +1393,20 @@ namespace juice
     {
       if (this != &rhs)
       {
-        rhs.apply_visitor_internal(assigner(*this, rhs.which()));
-        indicate_which(rhs.which());
+        //rhs might be destroyed by the assignment if it is in our tree
+        auto w = rhs.which();
+        if (w == tuple_not_found)
+        {
+          if (index() != tuple_not_found)
+          {
+            destroy();
+          }
+        }
+        else
+        {
+          rhs.apply_visitor_internal(assigner(*this, w));
+        }
+        indicate_which(w);
       }
       return *this;
     }
@@ -1002,20 +1456,16 @@ namespace juice
     >
     variant&
     operator=(T&& t) noexcept(
-      conjunction<(
-        std::is_nothrow_move_assignable<Types>::value &&
-        std::is_nothrow_move_constructible<Types>::value
-        )...
-      >::value
+      std::is_nothrow_assignable<assigned_type<T>&, T>::value &&
+      std::is_nothrow_constructible<assigned_type<T>, T>::value
     )
     {
-      typedef decltype(assign_FUN<Types...>::FUN(std::forward<T>(t))) type;
+      typedef assigned_type<T> type;
       constexpr auto I = tuple_find_v<type, variant>;
 
       if (index() != I)
       {
-        destroy();
-        new (&m_storage) type(std::forward<T>(t));
+        replace<type>(std::forward<T>(t));
       }
       else
       {
@@ -1038,6 +1488,28 @@ namespace juice
       return rhs.apply_visitor_internal(equality(*this));
     }
 
+    //returns less than, equal to or greater than zero as *this is less
+    //than, equal to or greater than rhs. Variants are ordered by index
+    //first, and a valueless variant is less than every other.
+    int
+    compare(const variant& rhs) const
+    {
+      //valueless wraps around to zero
+      size_t lhs_index = index() + 1;
+      size_t rhs_index = rhs.index() + 1;
+      if (lhs_index != rhs_index)
+      {
+        return lhs_index < rhs_index ? -1 : 1;
+      }
+
+      if (valueless_by_exception())
+      {
+        return 0;
+      }
+
+      return rhs.apply_visitor_internal(three_way_comparer(*this));
+    }
+
     size_t which() const {return m_which;}
 
     size_t index() const { return m_which; }
@@ -1066,14 +1538,18 @@ namespace juice
 
     void
     swap(variant& rhs)
+    noexcept(
+      is_trivially_relocatable<variant>::value ||
+      conjunction<(
+        std::is_nothrow_move_constructible<ref_type_t<Types>>::value &&
+        detail::swap_lookup::nothrow_swappable<ref_type_t<Types>>::value
+      )...
+      >::value
+    )
     {
-      if (m_which == rhs.index())
-      {
-        apply_visitor(detail::swapper(), *this, rhs);
-      }
-      else
+      if (this != &rhs)
       {
-        swap(*this, rhs);
+        swap(rhs, is_trivially_relocatable<variant>());
       }
     }
 
@@ -1084,7 +1560,8 @@ namespace juice
     {
       if (index() != I)
       {
-        throw bad_variant_access("Tuple does not contain requested item");
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
       }
 
       return reinterpret_cast<
@@ -1104,7 +1581,8 @@ namespace juice
       using E = typename std::tuple_element<I, variant>::type;
       if (index() != I)
       {
-        throw bad_variant_access("Tuple does not contain requested item");
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
       }
 
       return 
@@ -1123,7 +1601,8 @@ namespace juice
       using E = typename std::tuple_element<I, variant>::type;
       if (index() != I)
       {
-        throw bad_variant_access("Tuple does not contain requested item");
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
       }
 
       return 
@@ -1140,12 +1619,6 @@ namespace juice
 
     private:
 
-    typename 
-      std::aligned_storage<m_size, max<Alignof, Types...>::value>::type
-      m_storage;
-
-    size_t m_which;
-
     static std::function<void(void*)> m_handlers[1 + sizeof...(Types)];
 
     void indicate_which(size_t which) {m_which = which;}
@@ -1167,6 +1640,93 @@ namespace juice
       return apply_visitor<MPL::true_, Visitor>(std::forward<Visitor>(visitor));
     }
 
+    //the values can be swapped byte by byte, whatever their types are
+    void
+    swap(variant& rhs, std::true_type) noexcept
+    {
+      typename std::aligned_storage<sizeof(storage), alignof(storage)>::type
+        tmp;
+
+      storage* a = this;
+      storage* b = &rhs;
+      std::memcpy(&tmp, static_cast<void*>(a), sizeof(storage));
+      std::memcpy(static_cast<void*>(a), static_cast<void*>(b),
+        sizeof(storage));
+      std::memcpy(static_cast<void*>(b), &tmp, sizeof(storage));
+    }
+
+    void
+    swap(variant& rhs, std::false_type)
+    {
+      if (m_which == rhs.m_which)
+      {
+        typedef void (*swapper)(void*, void*);
+        static constexpr swapper swappers[] = {
+          &detail::swap_lookup::swap_values<ref_type_t<Types>>...
+        };
+
+        if (!valueless_by_exception())
+        {
+          swappers[m_which](&m_storage, &rhs.m_storage);
+        }
+      }
+      else if (rhs.valueless_by_exception())
+      {
+        rhs.take(*this);
+      }
+      else if (valueless_by_exception())
+      {
+        take(rhs);
+      }
+      else
+      {
+        variant tmp(std::move(rhs));
+        rhs = std::move(*this);
+        *this = std::move(tmp);
+      }
+    }
+
+    //replaces the value with a T made from u, when T is a different
+    //alternative to the current one
+    //u could be part of the tree of a recursive variant, which is destroyed
+    //first, so those go through a temporary
+    template <typename T, typename U>
+    void
+    replace(U&& u)
+    {
+      replace<T>(std::forward<U>(u), std::integral_constant<bool,
+        !conjunction<!is_recursive_wrapper<Types>::value...>::value>());
+    }
+
+    template <typename T, typename U>
+    void
+    replace(U&& u, std::false_type)
+    {
+      destroy();
+      new (&m_storage) T(std::forward<U>(u));
+    }
+
+    template <typename T, typename U>
+    void
+    replace(U&& u, std::true_type)
+    {
+      T tmp(std::forward<U>(u));
+      destroy();
+
+      //if this throws, then we are already empty
+      construct<T>(std::move(tmp));
+    }
+
+    //moves the value of from into this, which is empty, and leaves from
+    //empty
+    void
+    take(variant& from)
+    {
+      from.apply_visitor_internal(move_constructor(*this));
+      indicate_which(from.m_which);
+      from.destroy();
+    }
+
     void
     destroy()
     {
@@ -1200,6 +1760,24 @@ namespace juice
   template <typename... Types>
   using Variant = variant<Types...>;
 
+  //the storage of a variant holds nothing but its value and index
+  template <typename... Types>
+  struct is_trivially_relocatable<variant<Types...>>
+    : public std::integral_constant<bool,
+        conjunction<
+          is_trivially_relocatable<ref_type_t<Types>>::value...
+        >::value
+      >
+  {
+  };
+
+  template <typename... Types>
+  void
+  swap(variant<Types...>& a, variant<Types...>& b) noexcept(noexcept(a.swap(b)))
+  {
+    a.swap(b);
+  }
+
   struct bad_get : public std::exception
   {
     virtual const char* what() const throw()
@@ -1216,7 +1794,7 @@ namespace juice
     result_type
     operator()()
     {
-      throw bad_get();
+      detail::raise(bad_get());
     }
 
     result_type
@@ -1258,6 +1836,22 @@ namespace juice
   }
 //#endif
 
+  template <typename... Types>
+  class never_empty_variant;
+
+  namespace detail
+  {
+    template <typename T>
+    struct is_juice_variant : public std::false_type {};
+
+    template <typename... Types>
+    struct is_juice_variant<variant<Types...>> : public std::true_type {};
+
+    template <typename... Types>
+    struct is_juice_variant<never_empty_variant<Types...>>
+      : public std::true_type {};
+  }
+
   template <typename Visitor, typename... Visited>
   class MultiVisitor
   {
@@ -1331,6 +1925,22 @@ namespace juice
         apply_visitor<MPL::false_>(*this, std::forward<Args>(args)...);
     }
 
+    template <typename... Types, typename... Args>
+    decltype(auto)
+    visit(const never_empty_variant<Types...>& var, Args&&... args)
+    {
+      return var.template
+        apply_visitor<MPL::false_>(*this, std::forward<Args>(args)...);
+    }
+
+    template <typename... Types, typename... Args>
+    decltype(auto)
+    visit(never_empty_variant<Types...>& var, Args&&... args)
+    {
+      return var.template
+        apply_visitor<MPL::false_>(*this, std::forward<Args>(args)...);
+    }
+
     template <int... I, typename... Args>
     decltype(auto)
     do_visit(std::integer_sequence<int, I...>, Visitor&& v, Args&&... args)
@@ -1352,11 +1962,23 @@ namespace juice
     std::tuple<Visited&...> m_vs;
   };
 
-  template <typename Visitor, typename... Values>
+  //only takes our variants, so that std::visit is still found for a
+  //std::variant
+  template <typename Visitor, typename First, typename... Values,
+    typename = std::enable_if_t<
+      detail::is_juice_variant<std::decay_t<First>>::value>>
   decltype(auto)
-  visit(Visitor&& vis, Values&&... args)
+  visit(Visitor&& vis, First&& first, Values&&... args)
   {
-    return MultiVisitor<Visitor>(std::forward<Visitor>(vis)).visit(args...);
+    return MultiVisitor<Visitor>(std::forward<Visitor>(vis))
+      .visit(first, args...);
+  }
+
+  template <typename Visitor>
+  decltype(auto)
+  visit(Visitor&& vis)
+  {
+    return MultiVisitor<Visitor>(std::forward<Visitor>(vis)).visit();
   }
 
   // == variant get ==
@@ -1418,7 +2040,7 @@ namespace juice
   // === then the type versions ===
 
   template <typename T, typename... Types>
-  std::add_pointer_t<T>
+  auto
   get_if(variant<Types...>* var)
   {
     //return visit(get_visitor<T>(), *var);
@@ -1426,7 +2048,7 @@ namespace juice
   }
 
   template <typename T, typename... Types>
-  const std::add_pointer_t<const T>
+  auto
   get_if(const variant<Types...>* var)
   {
     //return visit(get_visitor<const T>(), *var);
@@ -1434,7 +2056,7 @@ namespace juice
   }
 
   template <typename T, typename... Types>
-  T&
+  auto&
   get (variant<Types...>& var)
   {
     //T* t = visit(get_visitor<T>(), var);
@@ -1445,7 +2067,7 @@ namespace juice
   }
 
   template <typename T, typename... Types>
-  const T&
+  auto&
   get (const variant<Types...>& var)
   {
     //const T* t = visit(get_visitor<const T>(), &var);
@@ -1462,6 +2084,86 @@ namespace juice
     return get<tuple_find<T, variant<Types...>>::value>(std::move(v));
   }
 
+  //the result of try_get, which refers to the alternative if the variant
+  //holds it, and otherwise is empty
+  template <typename T>
+  class get_result
+  {
+    public:
+
+    explicit
+    get_result(T* value)
+    : m_value(value)
+    {
+    }
+
+    bool has_value() const { return m_value != nullptr; }
+
+    explicit operator bool() const { return m_value != nullptr; }
+
+    T&
+    value() const
+    {
+      if (m_value == nullptr)
+      {
+        detail::raise(
+          bad_variant_access("Tuple does not contain requested item"));
+      }
+
+      return *m_value;
+    }
+
+    template <typename U>
+    std::remove_const_t<T>
+    value_or(U&& u) const
+    {
+      if (m_value == nullptr)
+      {
+        return static_cast<std::remove_const_t<T>>(std::forward<U>(u));
+      }
+
+      return *m_value;
+    }
+
+    T& operator*() const { return *m_value; }
+
+    T* operator->() const { return m_value; }
+
+    private:
+    T* m_value;
+  };
+
+  //like get, but returns a get_result instead of throwing
+  template <size_t I, typename... Types>
+  auto
+  try_get(variant<Types...>& v)
+  {
+    auto p = get_if<I>(&v);
+    return get_result<std::remove_pointer_t<decltype(p)>>(p);
+  }
+
+  template <size_t I, typename... Types>
+  auto
+  try_get(const variant<Types...>& v)
+  {
+    auto p = get_if<I>(&v);
+    return get_result<std::remove_pointer_t<decltype(p)>>(p);
+  }
+
+  template <typename T, typename... Types>
+  auto
+  try_get(variant<Types...>& v)
+  {
+    return try_get<tuple_find<T, variant<Types...>>::value>(v);
+  }
+
+  template <typename T, typename... Types>
+  auto
+  try_get(const variant<Types...>& v)
+  {
+    return try_get<tuple_find<T, variant<Types...>>::value>(v);
+  }
+
   struct visitor_applier
   {
     template <typename Visitor, typename Visitable, typename... Args>
@@ -1522,118 +2224,337 @@ namespace juice
   }
 
 
-  template <template <typename> class Compare>
-  struct RelationalVisitor
+  template <typename... Types>
+  int
+  compare(const variant<Types...>& v, const variant<Types...>& w)
   {
-    template <typename T, typename U>
-    bool
-    operator()(const T& t, const U& u) const
-    {
-      //this one should never be called
-      assert(false);
-    }
-
-    bool
-    operator()() const
-    {
-      //always false if one is empty
-      return false;
-    }
-
-    template <typename T>
-    bool
-    operator()(const T& a, const T& b) const
-    {
-      return Compare<T>()(a, b);
-    }
-  };
+    return v.compare(w);
+  }
 
-  template <template <typename> class Compare>
-  struct variantCompare
+  template <typename... Types>
+  bool
+  operator!=(const variant<Types...>& v, const variant<Types...>& w)
   {
-    template <typename... Types>
-    bool
-    operator()(const variant<Types...>& v, const variant<Types...>& w)
-    {
-      if (Compare<int>()(v.which(), w.which()))
-      {
-        return true;
-      }
-      else if (v.which() == w.which())
-      {
-        return visit(RelationalVisitor<Compare>(), v, w);
-      }
-      else
-      {
-        return false;
-      }
-    }
-  };
+    return !(v == w);
+  }
 
   template <typename... Types>
   bool
   operator<(const variant<Types...>& v, const variant<Types...>& w)
   {
-    return variantCompare<std::less>()(v, w);
+    return v.compare(w) < 0;
   }
 
   template <typename... Types>
   bool
   operator>(const variant<Types...>& v, const variant<Types...>& w)
   {
-    return variantCompare<std::greater>()(v, w);
+    return v.compare(w) > 0;
   }
 
   template <typename... Types>
   bool
   operator<=(const variant<Types...>& v, const variant<Types...>& w)
   {
-    return !variantCompare<std::greater>()(w, v);
+    return v.compare(w) <= 0;
   }
 
   template <typename... Types>
   bool
   operator>=(const variant<Types...>& v, const variant<Types...>& w)
   {
-    return !variantCompare<std::less>()(v, w);
+    return v.compare(w) >= 0;
+  }
+
+  // == comparison with a value ==
+
+  //a variant compares with a T as it would with a variant holding the T,
+  //but the T is compared in place with the alternative that it would be
+  //put in, so that comparing with a const char* doesn't make a std::string
+
+  namespace detail
+  {
+    template <typename T, typename... Types>
+    using compared_index_t = std::enable_if_t<
+      !std::is_same<T, variant<Types...>>::value &&
+      compared_index<T, Types...>::value != tuple_not_found,
+      compared_index<T, Types...>
+    >;
+
+    template <size_t I, typename T, typename... Types>
+    int
+    compare_value(const variant<Types...>& v, const T& t)
+    {
+      //valueless wraps around to zero
+      size_t index = v.index() + 1;
+      if (index != I + 1)
+      {
+        return index < I + 1 ? -1 : 1;
+      }
+
+      const auto& value = recursive_unwrap(v.template get<I>());
+      return value < t ? -1 : (t < value ? 1 : 0);
+    }
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  int
+  compare(const variant<Types...>& v, const T& t)
+  {
+    return detail::compare_value<I::value>(v, t);
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator==(const variant<Types...>& v, const T& t)
+  {
+    return v.index() == I::value &&
+      recursive_unwrap(v.template get<I::value>()) == t;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator==(const T& t, const variant<Types...>& v)
+  {
+    return v == t;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator!=(const variant<Types...>& v, const T& t)
+  {
+    return !(v == t);
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator!=(const T& t, const variant<Types...>& v)
+  {
+    return !(v == t);
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator<(const variant<Types...>& v, const T& t)
+  {
+    return detail::compare_value<I::value>(v, t) < 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator<(const T& t, const variant<Types...>& v)
+  {
+    return detail::compare_value<I::value>(v, t) > 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator>(const variant<Types...>& v, const T& t)
+  {
+    return detail::compare_value<I::value>(v, t) > 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator>(const T& t, const variant<Types...>& v)
+  {
+    return detail::compare_value<I::value>(v, t) < 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator<=(const variant<Types...>& v, const T& t)
+  {
+    return detail::compare_value<I::value>(v, t) <= 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator<=(const T& t, const variant<Types...>& v)
+  {
+    return detail::compare_value<I::value>(v, t) >= 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator>=(const variant<Types...>& v, const T& t)
+  {
+    return detail::compare_value<I::value>(v, t) >= 0;
+  }
+
+  template <typename... Types, typename T,
+    typename I = detail::compared_index_t<T, Types...>>
+  bool
+  operator>=(const T& t, const variant<Types...>& v)
+  {
+    return detail::compare_value<I::value>(v, t) <= 0;
   }
 }
 
-namespace std {
-  using juice::visit;
-  using juice::get;
+namespace juice
+{
+  // == hashing ==
 
   namespace detail
   {
-    inline
-    size_t
-    hash_combine(size_t seed, size_t combine)
+    //the finaliser of splitmix64, every bit of x affects every bit of the
+    //result
+    constexpr
+    std::uint64_t
+    mix64(std::uint64_t x)
     {
-      return seed ^ (combine + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+      x ^= x >> 30;
+      x *= 0xbf58476d1ce4e5b9;
+      x ^= x >> 27;
+      x *= 0x94d049bb133111eb;
+      x ^= x >> 31;
+      return x;
     }
 
-    struct hash_visitor
+    constexpr
+    size_t
+    hash_combine(size_t seed, size_t value)
     {
-      template <typename T>
-      size_t
-      operator()(const T& t)
-      {
-        type_index ti(typeid(t));
-        size_t h = std::hash<type_index>()(ti);
-        h = hash_combine(h, std::hash<T>()(t));
+      return static_cast<size_t>(mix64(seed ^ (value + 0x9e3779b97f4a7c15 +
+        (seed << 6) + (seed >> 2))));
+    }
 
-        return h;
-      }
+    //every alternative starts from a different seed, so that equal values
+    //of different alternatives hash differently
+    template <size_t I>
+    struct index_seed
+      : public std::integral_constant<size_t,
+          static_cast<size_t>(mix64(I + 1))>
+    {
     };
   }
 
+  //hashes the value of an alternative with std::hash
+  struct std_hasher
+  {
+    template <typename T>
+    size_t
+    operator()(const T& t) const
+    {
+      return std::hash<T>()(t);
+    }
+  };
+
+  //hashes integers, enums and pointers with mix64, which spreads them over
+  //every bit where std::hash is often the identity, and everything else with
+  //std::hash
+  struct mix_hasher
+  {
+    template <typename T>
+    size_t
+    operator()(const T& t) const
+    {
+      return hash(t, std::integral_constant<bool,
+        std::is_integral<T>::value || std::is_enum<T>::value>());
+    }
+
+    template <typename T>
+    size_t
+    operator()(T* t) const
+    {
+      return static_cast<size_t>(
+        detail::mix64(reinterpret_cast<std::uintptr_t>(t)));
+    }
+
+    private:
+    template <typename T>
+    size_t
+    hash(const T& t, std::true_type) const
+    {
+      return static_cast<size_t>(detail::mix64(static_cast<std::uint64_t>(t)));
+    }
+
+    template <typename T>
+    size_t
+    hash(const T& t, std::false_type) const
+    {
+      return std::hash<T>()(t);
+    }
+  };
+
+  //hashes a variant by combining a seed for its index with the hash of its
+  //value from Hash, which is called with the stored alternative, so a
+  //recursive_wrapper is hashed without unwrapping. Nothing about it depends
+  //on RTTI.
+  template <typename Hash = std_hasher>
+  struct basic_variant_hash
+  {
+    basic_variant_hash(Hash hash = Hash())
+    : m_hash(hash)
+    {
+    }
+
+    template <typename... Types>
+    size_t
+    operator()(const variant<Types...>& v) const
+    {
+      if (v.valueless_by_exception())
+      {
+        return detail::index_seed<tuple_not_found>::value;
+      }
+
+      return hash(v, std::index_sequence_for<Types...>());
+    }
+
+    private:
+    template <typename... Types, size_t... I>
+    size_t
+    hash(const variant<Types...>& v, std::index_sequence<I...>) const
+    {
+      typedef size_t (*hasher)(const Hash&, const variant<Types...>&);
+      static constexpr hasher table[] = {&hash_at<I, Types...>...};
+
+      return table[v.index()](m_hash, v);
+    }
+
+    template <size_t I, typename... Types>
+    static
+    size_t
+    hash_at(const Hash& h, const variant<Types...>& v)
+    {
+      return detail::hash_combine(detail::index_seed<I>::value,
+        h(v.template get<I>()));
+    }
+
+    Hash m_hash;
+  };
+}
+
+namespace std {
+  using juice::visit;
+  using juice::get;
+
+  //the stored alternative is hashed without unwrapping, so that a wrapper
+  //can decide how its subtree is hashed
   template <typename... Types>
-  struct hash<juice::variant<Types...>>
+  struct hash<juice::variant<Types...>> : public juice::basic_variant_hash<>
+  {
+  };
+
+  template <typename T>
+  struct hash<juice::recursive_wrapper<T>>
   {
     size_t
-    operator()(const juice::variant<Types...>& v)
+    operator()(const juice::recursive_wrapper<T>& r) const
     {
-      return visit(detail::hash_visitor(), v);
+      return r.hash();
     }
   };
 
@@ -1641,7 +2562,7 @@ namespace std {
   struct hash<juice::monostate>
   {
     size_t
-    operator()(const juice::monostate&)
+    operator()(const juice::monostate&) const
     {
       return 47;
     }
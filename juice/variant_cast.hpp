@@ -0,0 +1,334 @@
+// Conversions between variants with different sets of types.
+//
+// variant_cast<To>(from) converts a variant into a variant of another type
+// that has the alternative that from holds, such as widening variant<A, B>
+// to variant<C, A, B, D>. The index of every alternative of from in To is
+// found at compile time, so a cast is one lookup in a table by the index of
+// from, and the value is moved or copied straight into the new variant
+// without any overload resolution. Moving a recursive_wrapper this way only
+// moves its pointer.
+//
+// When To is missing the alternative that from holds the cast throws
+// bad_variant_cast. try_variant_cast<To>(from) returns a cast_result
+// instead, which is empty when the cast fails, so that narrowing casts can
+// be used without exceptions. variant_castable<To>(from) tells whether a
+// cast would succeed, and widening casts, where To has every alternative,
+// are known to succeed at compile time.
+
+#ifndef JUICE_VARIANT_CAST_HPP_INCLUDED
+#define JUICE_VARIANT_CAST_HPP_INCLUDED
+
+#include <new>
+#include <type_traits>
+#include <typeinfo>
+
+#include "variant.hpp"
+
+namespace juice
+{
+  struct bad_variant_cast : public std::bad_cast
+  {
+    virtual const char* what() const throw()
+    {
+      return "bad_variant_cast";
+    }
+  };
+
+  //the result of try_variant_cast, which holds the new variant if the cast
+  //succeeded, and otherwise is empty
+  template <typename To>
+  class cast_result
+  {
+    public:
+
+    cast_result()
+    : m_has_value(false)
+    {
+    }
+
+    template <size_t I, typename U>
+    cast_result(emplaced_index_t<I> index, U&& u)
+    : m_has_value(false)
+    {
+      new (&m_storage) To(index, std::forward<U>(u));
+      m_has_value = true;
+    }
+
+    cast_result(const cast_result& rhs)
+    : m_has_value(false)
+    {
+      if (rhs.m_has_value)
+      {
+        new (&m_storage) To(rhs.get());
+        m_has_value = true;
+      }
+    }
+
+    cast_result(cast_result&& rhs)
+      noexcept(std::is_nothrow_move_constructible<To>::value)
+    : m_has_value(false)
+    {
+      if (rhs.m_has_value)
+      {
+        new (&m_storage) To(std::move(rhs.get()));
+        m_has_value = true;
+      }
+    }
+
+    ~cast_result()
+    {
+      if (m_has_value)
+      {
+        get().~To();
+      }
+    }
+
+    cast_result&
+    operator=(const cast_result&) = delete;
+
+    bool has_value() const { return m_has_value; }
+
+    explicit operator bool() const { return m_has_value; }
+
+    To&
+    value() &
+    {
+      check();
+      return get();
+    }
+
+    const To&
+    value() const &
+    {
+      check();
+      return get();
+    }
+
+    To&&
+    value() &&
+    {
+      check();
+      return std::move(get());
+    }
+
+    template <typename U>
+    To
+    value_or(U&& u) const &
+    {
+      if (!m_has_value)
+      {
+        return To(std::forward<U>(u));
+      }
+
+      return get();
+    }
+
+    To& operator*() { return get(); }
+    const To& operator*() const { return get(); }
+
+    To* operator->() { return &get(); }
+    const To* operator->() const { return &get(); }
+
+    private:
+    void
+    check() const
+    {
+      if (!m_has_value)
+      {
+        detail::raise(bad_variant_cast());
+      }
+    }
+
+    To& get() { return reinterpret_cast<To&>(m_storage); }
+    const To& get() const { return reinterpret_cast<const To&>(m_storage); }
+
+    std::aligned_storage_t<sizeof(To), alignof(To)> m_storage;
+    bool m_has_value;
+  };
+
+  namespace detail
+  {
+    template <typename To, typename From>
+    struct variant_caster;
+
+    template <typename To, typename... Types>
+    struct variant_caster<To, variant<Types...>>
+    {
+      typedef variant<Types...> From;
+
+      template <size_t I>
+      using target = tuple_find<std::tuple_element_t<I, From>, To>;
+
+      static constexpr bool widening = conjunction<
+        (tuple_find<Types, To>::value != tuple_not_found)...
+      >::value;
+
+      static
+      bool
+      castable(size_t index)
+      {
+        static constexpr bool table[] = {
+          (tuple_find<Types, To>::value != tuple_not_found)...
+        };
+
+        return index != tuple_not_found && table[index];
+      }
+
+      //F is const From& or From
+      template <typename F>
+      static
+      cast_result<To>
+      try_cast(F&& from)
+      {
+        if (from.valueless_by_exception())
+        {
+          return cast_result<To>();
+        }
+
+        return try_cast(std::forward<F>(from), from.index(),
+          std::index_sequence_for<Types...>());
+      }
+
+      template <typename F>
+      static
+      To
+      cast(F&& from)
+      {
+        return cast(std::forward<F>(from),
+          std::integral_constant<bool, widening>());
+      }
+
+      private:
+      template <typename F, size_t... I>
+      static
+      cast_result<To>
+      try_cast(F&& from, size_t index, std::index_sequence<I...>)
+      {
+        typedef cast_result<To> (*caster)(F&&);
+        static constexpr caster table[] = {&try_cast_at<I, F>...};
+
+        return table[index](std::forward<F>(from));
+      }
+
+      template <size_t I, typename F>
+      static
+      cast_result<To>
+      try_cast_at(F&& from)
+      {
+        return try_cast_at<I>(std::forward<F>(from),
+          std::integral_constant<bool,
+            target<I>::value != tuple_not_found>());
+      }
+
+      template <size_t I, typename F>
+      static
+      cast_result<To>
+      try_cast_at(F&& from, std::true_type)
+      {
+        return cast_result<To>(emplaced_index<target<I>::value>,
+          std::forward<F>(from).template get<I>());
+      }
+
+      template <size_t I, typename F>
+      static
+      cast_result<To>
+      try_cast_at(F&&, std::false_type)
+      {
+        return cast_result<To>();
+      }
+
+      //a narrowing cast is a try_cast that throws when it fails
+      template <typename F>
+      static
+      To
+      cast(F&& from, std::false_type)
+      {
+        return try_cast(std::forward<F>(from)).value();
+      }
+
+      //a widening cast only fails when from is valueless, and constructs
+      //the new variant straight away
+      template <typename F>
+      static
+      To
+      cast(F&& from, std::true_type)
+      {
+        if (from.valueless_by_exception())
+        {
+          detail::raise(bad_variant_cast());
+        }
+
+        return widen(std::forward<F>(from), from.index(),
+          std::index_sequence_for<Types...>());
+      }
+
+      template <typename F, size_t... I>
+      static
+      To
+      widen(F&& from, size_t index, std::index_sequence<I...>)
+      {
+        typedef To (*caster)(F&&);
+        static constexpr caster table[] = {&widen_at<I, F>...};
+
+        return table[index](std::forward<F>(from));
+      }
+
+      template <size_t I, typename F>
+      static
+      To
+      widen_at(F&& from)
+      {
+        return To(emplaced_index<target<I>::value>,
+          std::forward<F>(from).template get<I>());
+      }
+    };
+  }
+
+  //true when To can hold every alternative of From
+  template <typename To, typename From>
+  constexpr bool is_widening_cast_v =
+    detail::variant_caster<To, std::decay_t<From>>::widening;
+
+  template <typename To, typename... Types>
+  bool
+  variant_castable(const variant<Types...>& from)
+  {
+    return detail::variant_caster<To, variant<Types...>>::castable(
+      from.index());
+  }
+
+  template <typename To, typename... Types>
+  To
+  variant_cast(const variant<Types...>& from)
+  {
+    return detail::variant_caster<To, variant<Types...>>::cast(from);
+  }
+
+  //the value of from is moved, from keeps the same index
+  template <typename To, typename... Types>
+  To
+  variant_cast(variant<Types...>&& from)
+  {
+    return detail::variant_caster<To, variant<Types...>>::cast(
+      std::move(from));
+  }
+
+  //like variant_cast, but returns an empty cast_result instead of throwing
+  //when To doesn't have the alternative of from
+  template <typename To, typename... Types>
+  cast_result<To>
+  try_variant_cast(const variant<Types...>& from)
+  {
+    return detail::variant_caster<To, variant<Types...>>::try_cast(from);
+  }
+
+  template <typename To, typename... Types>
+  cast_result<To>
+  try_variant_cast(variant<Types...>&& from)
+  {
+    return detail::variant_caster<To, variant<Types...>>::try_cast(
+      std::move(from));
+  }
+}
+
+#endif
@@ -0,0 +1,168 @@
+// Hashing and comparing variants and the values that they hold, for
+// containers that look up a variant key with a value.
+//
+// variant_hash<V> and variant_equal<V> are transparent: they take a V, or a
+// value of one of its types, or a value that would be compared with one of
+// its types such as a const char* or a std::string_view for a std::string.
+// A value hashes the same as a V holding it, and compares equal to a V
+// holding an equal value, without making a V.
+//
+// A value of another type is hashed as the alternative that it is compared
+// with, see compared_index in variant.hpp. For a std::basic_string
+// alternative the value is hashed as a std::basic_string_view in C++17,
+// which hashes the same as the string, and otherwise the value is converted
+// to the alternative first.
+
+#ifndef JUICE_VARIANT_HASH_HPP_INCLUDED
+#define JUICE_VARIANT_HASH_HPP_INCLUDED
+
+#include <string>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#endif
+
+#include "variant.hpp"
+
+namespace juice
+{
+  namespace detail
+  {
+    //converts a value to something that hashes the same as the alternative
+    //A holding it
+    template <typename A>
+    struct hash_converter
+    {
+      template <typename T>
+      static
+      A
+      convert(const T& t)
+      {
+        return A(t);
+      }
+    };
+
+#if __cplusplus >= 201703L
+    template <typename Char, typename Traits, typename Allocator>
+    struct hash_converter<std::basic_string<Char, Traits, Allocator>>
+    {
+      typedef std::basic_string<Char, Traits, Allocator> string;
+      typedef std::basic_string_view<Char, Traits> view;
+
+      template <typename T>
+      static
+      decltype(auto)
+      convert(const T& t)
+      {
+        return convert(t, std::is_convertible<const T&, view>());
+      }
+
+      template <typename T>
+      static
+      view
+      convert(const T& t, std::true_type)
+      {
+        return t;
+      }
+
+      template <typename T>
+      static
+      string
+      convert(const T& t, std::false_type)
+      {
+        return string(t);
+      }
+    };
+#endif
+
+    template <typename A, typename T, typename Hash>
+    size_t
+    hash_as(const Hash& hash, const T& t, std::true_type)
+    {
+      return hash(t);
+    }
+
+    template <typename A, typename T, typename Hash>
+    size_t
+    hash_as(const Hash& hash, const T& t, std::false_type)
+    {
+      return hash(hash_converter<A>::convert(t));
+    }
+
+    //hashes t as if it were the alternative A
+    template <typename A, typename T, typename Hash>
+    size_t
+    hash_as(const Hash& hash, const T& t)
+    {
+      return hash_as<A>(hash, t, std::is_same<unwrapped_type_t<A>, T>());
+    }
+  }
+
+  template <typename V, typename Hash = std_hasher>
+  struct variant_hash;
+
+  template <typename... Types, typename Hash>
+  struct variant_hash<variant<Types...>, Hash>
+  {
+    typedef void is_transparent;
+
+    variant_hash(Hash hash = Hash())
+    : m_hash(hash)
+    , m_variant_hash(hash)
+    {
+    }
+
+    size_t
+    operator()(const variant<Types...>& v) const
+    {
+      return m_variant_hash(v);
+    }
+
+    template <typename T,
+      typename I = detail::compared_index_t<T, Types...>>
+    size_t
+    operator()(const T& t) const
+    {
+      typedef std::tuple_element_t<I::value, variant<Types...>> A;
+      return detail::hash_combine(detail::index_seed<I::value>::value,
+        detail::hash_as<A>(m_hash, t));
+    }
+
+    private:
+    Hash m_hash;
+    basic_variant_hash<Hash> m_variant_hash;
+  };
+
+  template <typename V>
+  struct variant_equal;
+
+  template <typename... Types>
+  struct variant_equal<variant<Types...>>
+  {
+    typedef void is_transparent;
+
+    bool
+    operator()(const variant<Types...>& v, const variant<Types...>& w) const
+    {
+      return v == w;
+    }
+
+    template <typename T,
+      typename I = detail::compared_index_t<T, Types...>>
+    bool
+    operator()(const variant<Types...>& v, const T& t) const
+    {
+      return v == t;
+    }
+
+    template <typename T,
+      typename I = detail::compared_index_t<T, Types...>>
+    bool
+    operator()(const T& t, const variant<Types...>& v) const
+    {
+      return v == t;
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,624 @@
+// An open addressing hash map with variant keys.
+//
+// Every slot has a control byte, which is empty, deleted, or seven bits of
+// the hash of its key, and a tag byte, which is the index of the alternative
+// that its key holds. The control and tag bytes are kept in their own arrays
+// next to each other, so a probe reads a few bytes per slot and only
+// compares keys when both the hash bits and the tag match. Then the keys are
+// known to hold the same alternative, so the comparison is one dispatch.
+//
+// Entries are stored in the slots when K and V can be moved without
+// throwing, as a variant of integers and std::string can. Growing the table
+// moves each entry to its new slot, which is a memcpy when std::pair<const K,
+// V> is trivially relocatable. Otherwise the slots hold pointers to entries
+// allocated separately, so that a move that throws never leaves the table
+// half grown. Growing the table invalidates references to entries in the
+// slots, but not to entries that are allocated separately.
+//
+// A valueless key can't be inserted, and raises bad_variant_access, so it is
+// never found.
+//
+// Lookups are heterogeneous through variant_hash and variant_equal: find,
+// count and erase take a K or a value of one of its alternatives, and a
+// string alternative can be found with a const char* without making a K.
+
+#ifndef JUICE_VARIANT_HASH_MAP_HPP_INCLUDED
+#define JUICE_VARIANT_HASH_MAP_HPP_INCLUDED
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "relocate.hpp"
+#include "variant_hash.hpp"
+
+namespace juice
+{
+  namespace detail
+  {
+    //the alternative that a key holds, or that a value would be compared
+    //with
+    template <typename... Types>
+    size_t
+    key_tag(const variant<Types...>& v, const variant<Types...>*)
+    {
+      return v.index();
+    }
+
+    template <typename T, typename... Types,
+      typename I = compared_index_t<T, Types...>>
+    size_t
+    key_tag(const T&, const variant<Types...>*)
+    {
+      return I::value;
+    }
+
+    template <typename... Types>
+    bool
+    key_valueless(const variant<Types...>& v)
+    {
+      return v.valueless_by_exception();
+    }
+
+    template <typename T>
+    bool
+    key_valueless(const T&)
+    {
+      return false;
+    }
+  }
+
+  template
+  <
+    typename K,
+    typename V,
+    typename Hash = variant_hash<K>,
+    typename Equal = variant_equal<K>
+  >
+  class variant_hash_map
+  {
+    public:
+
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<const K, V> value_type;
+
+    static_assert(std::tuple_size<K>::value < 255,
+      "the index of a key must fit in a tag byte");
+
+    private:
+
+    static constexpr bool inline_entries =
+      is_trivially_relocatable<value_type>::value ||
+      (std::is_nothrow_move_constructible<K>::value &&
+       std::is_nothrow_move_constructible<V>::value);
+
+    typedef std::conditional_t<inline_entries, value_type, value_type*>
+      slot_type;
+
+    typedef std::aligned_storage_t<sizeof(slot_type), alignof(slot_type)>
+      slot;
+
+    enum : std::int8_t
+    {
+      slot_empty = -128,
+      slot_deleted = -2
+    };
+
+    public:
+
+    template <bool Const>
+    class basic_iterator
+    {
+      public:
+
+      typedef std::forward_iterator_tag iterator_category;
+      typedef variant_hash_map::value_type value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef std::conditional_t<Const, const value_type, value_type>*
+        pointer;
+      typedef std::conditional_t<Const, const value_type, value_type>&
+        reference;
+
+      basic_iterator() = default;
+
+      //an iterator converts to a const_iterator
+      basic_iterator(const basic_iterator<false>& rhs)
+      : m_map(rhs.m_map)
+      , m_slot(rhs.m_slot)
+      {
+      }
+
+      reference operator*() const { return m_map->entry(m_slot); }
+      pointer operator->() const { return &m_map->entry(m_slot); }
+
+      basic_iterator&
+      operator++()
+      {
+        m_slot = m_map->next_full(m_slot + 1);
+        return *this;
+      }
+
+      basic_iterator
+      operator++(int)
+      {
+        basic_iterator result = *this;
+        ++*this;
+        return result;
+      }
+
+      bool
+      operator==(const basic_iterator& rhs) const
+      {
+        return m_slot == rhs.m_slot;
+      }
+
+      bool
+      operator!=(const basic_iterator& rhs) const
+      {
+        return m_slot != rhs.m_slot;
+      }
+
+      private:
+      friend class variant_hash_map;
+      friend class basic_iterator<!Const>;
+
+      typedef std::conditional_t<Const, const variant_hash_map,
+        variant_hash_map> map_type;
+
+      basic_iterator(map_type* map, size_t s)
+      : m_map(map)
+      , m_slot(s)
+      {
+      }
+
+      map_type* m_map = nullptr;
+      size_t m_slot = 0;
+    };
+
+    typedef basic_iterator<false> iterator;
+    typedef basic_iterator<true> const_iterator;
+
+    variant_hash_map(Hash hash = Hash(), Equal equal = Equal())
+    : m_hash(hash)
+    , m_equal(equal)
+    {
+    }
+
+    variant_hash_map(const variant_hash_map& rhs)
+    : m_hash(rhs.m_hash)
+    , m_equal(rhs.m_equal)
+    {
+      reserve(rhs.size());
+      for (const auto& e : rhs)
+      {
+        insert(e);
+      }
+    }
+
+    variant_hash_map(variant_hash_map&& rhs) noexcept
+    : m_hash(rhs.m_hash)
+    , m_equal(rhs.m_equal)
+    {
+      swap(rhs);
+    }
+
+    ~variant_hash_map()
+    {
+      clear();
+    }
+
+    variant_hash_map&
+    operator=(variant_hash_map rhs)
+    {
+      swap(rhs);
+      return *this;
+    }
+
+    void
+    swap(variant_hash_map& rhs) noexcept
+    {
+      using std::swap;
+      swap(m_hash, rhs.m_hash);
+      swap(m_equal, rhs.m_equal);
+      m_control.swap(rhs.m_control);
+      m_tags.swap(rhs.m_tags);
+      m_slots.swap(rhs.m_slots);
+      swap(m_size, rhs.m_size);
+      swap(m_deleted, rhs.m_deleted);
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    size_t bucket_count() const { return m_control.size(); }
+
+    iterator begin() { return iterator(this, next_full(0)); }
+    iterator end() { return iterator(this, bucket_count()); }
+    const_iterator begin() const { return const_iterator(this, next_full(0)); }
+    const_iterator end() const { return const_iterator(this, bucket_count()); }
+
+    template <typename Key>
+    iterator
+    find(const Key& key)
+    {
+      return iterator(this, find_slot(key));
+    }
+
+    template <typename Key>
+    const_iterator
+    find(const Key& key) const
+    {
+      return const_iterator(this, find_slot(key));
+    }
+
+    template <typename Key>
+    size_t
+    count(const Key& key) const
+    {
+      return find_slot(key) != bucket_count();
+    }
+
+    template <typename Key>
+    bool
+    contains(const Key& key) const
+    {
+      return count(key) != 0;
+    }
+
+    //inserts a value made from args if there isn't one for key
+    template <typename... Args>
+    std::pair<iterator, bool>
+    try_emplace(const K& key, Args&&... args)
+    {
+      return emplace_key(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool>
+    try_emplace(K&& key, Args&&... args)
+    {
+      return emplace_key(std::move(key), std::forward<Args>(args)...);
+    }
+
+    std::pair<iterator, bool>
+    insert(const value_type& value)
+    {
+      return emplace_key(value.first, value.second);
+    }
+
+    std::pair<iterator, bool>
+    insert(value_type&& value)
+    {
+      return emplace_key(value.first, std::move(value.second));
+    }
+
+    V&
+    operator[](const K& key)
+    {
+      return try_emplace(key).first->second;
+    }
+
+    V&
+    operator[](K&& key)
+    {
+      return try_emplace(std::move(key)).first->second;
+    }
+
+    template <typename Key>
+    size_t
+    erase(const Key& key)
+    {
+      size_t s = find_slot(key);
+      if (s == bucket_count())
+      {
+        return 0;
+      }
+
+      erase_slot(s);
+      return 1;
+    }
+
+    iterator
+    erase(const_iterator pos)
+    {
+      erase_slot(pos.m_slot);
+      return iterator(this, next_full(pos.m_slot + 1));
+    }
+
+    void
+    clear()
+    {
+      for (size_t s = 0; s != bucket_count(); ++s)
+      {
+        if (m_control[s] >= 0)
+        {
+          destroy(s);
+        }
+      }
+
+      std::fill(m_control.begin(), m_control.end(), slot_empty);
+      m_size = 0;
+      m_deleted = 0;
+    }
+
+    //makes room for n entries without growing
+    void
+    reserve(size_t n)
+    {
+      size_t buckets = 8;
+      while (buckets - buckets / 8 < n)
+      {
+        buckets *= 2;
+      }
+
+      if (buckets > bucket_count())
+      {
+        rehash(buckets);
+      }
+    }
+
+    private:
+
+    template <bool Const>
+    friend class basic_iterator;
+
+    value_type&
+    entry(size_t s)
+    {
+      return entry(s, std::integral_constant<bool, inline_entries>());
+    }
+
+    const value_type&
+    entry(size_t s) const
+    {
+      return const_cast<variant_hash_map*>(this)->entry(s);
+    }
+
+    value_type&
+    entry(size_t s, std::true_type)
+    {
+      return reinterpret_cast<value_type&>(m_slots[s]);
+    }
+
+    value_type&
+    entry(size_t s, std::false_type)
+    {
+      return *reinterpret_cast<value_type*&>(m_slots[s]);
+    }
+
+    size_t
+    next_full(size_t s) const
+    {
+      while (s != bucket_count() && m_control[s] < 0)
+      {
+        ++s;
+      }
+      return s;
+    }
+
+    //the top seven bits of the hash are stored in the control byte, and the
+    //rest choose the first slot
+    static
+    std::int8_t
+    control_bits(size_t hash)
+    {
+      return static_cast<std::int8_t>(hash >> (sizeof(size_t) * 8 - 7));
+    }
+
+    template <typename Key>
+    size_t
+    find_slot(const Key& key) const
+    {
+      if (m_size == 0 || detail::key_valueless(key))
+      {
+        return bucket_count();
+      }
+
+      size_t hash = m_hash(key);
+      std::int8_t control = control_bits(hash);
+      size_t tag = detail::key_tag(key, static_cast<const K*>(nullptr));
+      size_t mask = bucket_count() - 1;
+
+      for (size_t s = hash & mask; ; s = (s + 1) & mask)
+      {
+        if (m_control[s] == slot_empty)
+        {
+          return bucket_count();
+        }
+
+        if (m_control[s] == control && m_tags[s] == tag &&
+            m_equal(entry(s).first, key))
+        {
+          return s;
+        }
+      }
+    }
+
+    template <typename Key, typename... Args>
+    std::pair<iterator, bool>
+    emplace_key(Key&& key, Args&&... args)
+    {
+      if (key.valueless_by_exception())
+      {
+        detail::raise(bad_variant_access("Can't insert a valueless key"));
+      }
+
+      size_t found = find_slot(key);
+      if (found != bucket_count())
+      {
+        return std::make_pair(iterator(this, found), false);
+      }
+
+      if (m_size + m_deleted + 1 > bucket_count() - bucket_count() / 8)
+      {
+        //clean out deleted slots when there are many, grow otherwise
+        rehash(m_size + 1 > bucket_count() / 2 ? std::max<size_t>(
+          bucket_count() * 2, 8) : bucket_count());
+      }
+
+      size_t hash = m_hash(key);
+      size_t s = free_slot(hash);
+
+      construct(s, std::piecewise_construct,
+        std::forward_as_tuple(std::forward<Key>(key)),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+
+      if (m_control[s] == slot_deleted)
+      {
+        --m_deleted;
+      }
+      m_control[s] = control_bits(hash);
+      m_tags[s] = static_cast<std::uint8_t>(entry(s).first.index());
+      ++m_size;
+
+      return std::make_pair(iterator(this, s), true);
+    }
+
+    size_t
+    free_slot(size_t hash) const
+    {
+      size_t mask = bucket_count() - 1;
+      size_t s = hash & mask;
+      while (m_control[s] >= 0)
+      {
+        s = (s + 1) & mask;
+      }
+      return s;
+    }
+
+    template <typename... Args>
+    void
+    construct(size_t s, Args&&... args)
+    {
+      construct(s, std::integral_constant<bool, inline_entries>(),
+        std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void
+    construct(size_t s, std::true_type, Args&&... args)
+    {
+      new (&m_slots[s]) value_type(std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    void
+    construct(size_t s, std::false_type, Args&&... args)
+    {
+      new (&m_slots[s]) value_type*(
+        new value_type(std::forward<Args>(args)...));
+    }
+
+    void
+    destroy(size_t s)
+    {
+      destroy(s, std::integral_constant<bool, inline_entries>());
+    }
+
+    void
+    destroy(size_t s, std::true_type)
+    {
+      entry(s).~value_type();
+    }
+
+    void
+    destroy(size_t s, std::false_type)
+    {
+      delete &entry(s);
+    }
+
+    void
+    erase_slot(size_t s)
+    {
+      destroy(s);
+      --m_size;
+
+      //a slot followed by an empty one ends every probe that reaches it, so
+      //it can be emptied instead of marked as deleted
+      if (m_control[(s + 1) & (bucket_count() - 1)] == slot_empty)
+      {
+        m_control[s] = slot_empty;
+      }
+      else
+      {
+        m_control[s] = slot_deleted;
+        ++m_deleted;
+      }
+    }
+
+    //moves an entry from one slot to another, where a pointer is copied
+    void
+    relocate_slot(slot& from, slot& to)
+    {
+      relocate_slot(from, to, std::integral_constant<bool,
+        !inline_entries || is_trivially_relocatable<value_type>::value>());
+    }
+
+    void
+    relocate_slot(slot& from, slot& to, std::true_type)
+    {
+      std::memcpy(static_cast<void*>(&to), static_cast<const void*>(&from),
+        sizeof(slot));
+    }
+
+    //the key is only const to users of the map, so it is moved from, which
+    //doesn't throw, instead of copied
+    void
+    relocate_slot(slot& from, slot& to, std::false_type)
+    {
+      auto& e = reinterpret_cast<std::pair<K, V>&>(from);
+      new (&to) value_type(std::move(e));
+      reinterpret_cast<value_type&>(from).~value_type();
+    }
+
+    //moves every entry to a table of the given size, a power of two
+    void
+    rehash(size_t buckets)
+    {
+      std::vector<std::int8_t> control(buckets, slot_empty);
+      std::vector<std::uint8_t> tags(buckets);
+      std::vector<slot> slots(buckets);
+
+      m_control.swap(control);
+      m_tags.swap(tags);
+      m_slots.swap(slots);
+      m_deleted = 0;
+
+      for (size_t s = 0; s != control.size(); ++s)
+      {
+        if (control[s] < 0)
+        {
+          continue;
+        }
+
+        const value_type& e = inline_entries
+          ? reinterpret_cast<const value_type&>(slots[s])
+          : *reinterpret_cast<value_type* const&>(slots[s]);
+        size_t hash = m_hash(e.first);
+
+        size_t to = free_slot(hash);
+        relocate_slot(slots[s], m_slots[to]);
+        m_control[to] = control_bits(hash);
+        m_tags[to] = tags[s];
+      }
+    }
+
+    Hash m_hash;
+    Equal m_equal;
+
+    std::vector<std::int8_t> m_control;
+    std::vector<std::uint8_t> m_tags;
+    std::vector<slot> m_slots;
+
+    size_t m_size = 0;
+    size_t m_deleted = 0;
+  };
+}
+
+#endif
@@ -0,0 +1,244 @@
+// A non-owning view of a value that is one of several types.
+//
+// variant_ref<Types...> is a pointer to the value and the index of its
+// type, so it is trivially copyable and two words, and can be passed by
+// value where passing a variant would copy the value. It can be made from
+// a variant with matching alternatives or from a value of one of the types,
+// and it refers to that value for as long as it lives.
+//
+// The types are the types of the values, and can also be written the way
+// the variant writes them. For variant<int, recursive_wrapper<Node>, char&>
+// the view can be variant_ref<int, Node, char>, or the same types as the
+// variant. A view with const types, such as variant_ref<const int,
+// const std::string>, gives const access and can view a const variant.
+//
+// The value is read with visit, get and get_if as for a variant. A view
+// can't be valueless, and making one from a valueless variant throws
+// bad_variant_access.
+
+#ifndef JUICE_VARIANT_REF_HPP_INCLUDED
+#define JUICE_VARIANT_REF_HPP_INCLUDED
+
+#include <limits>
+#include <memory>
+
+#include "variant.hpp"
+
+namespace juice
+{
+  namespace detail
+  {
+    //the type of the value that an alternative refers to
+    template <typename T>
+    using viewed_type_t = std::remove_reference_t<unwrapped_type_t<T>>;
+
+    template <typename View, typename Alternative>
+    struct view_matches
+      : public std::integral_constant<bool,
+          std::is_same<
+            std::remove_const_t<viewed_type_t<View>>,
+            std::remove_const_t<viewed_type_t<Alternative>>
+          >::value &&
+          (std::is_const<viewed_type_t<View>>::value ||
+           !std::is_const<viewed_type_t<Alternative>>::value)
+        >
+    {
+    };
+
+    template <typename View, typename Variant>
+    struct views_variant : public std::false_type {};
+
+    template <typename... ViewTypes, typename... Types>
+    struct views_variant<std::tuple<ViewTypes...>, variant<Types...>>
+      : public std::integral_constant<bool,
+          sizeof...(ViewTypes) == sizeof...(Types) &&
+          conjunction<view_matches<ViewTypes, Types>::value...>::value
+        >
+    {
+    };
+
+    template <typename... ViewTypes, typename... Types>
+    struct views_variant<std::tuple<ViewTypes...>, const variant<Types...>>
+      : public std::integral_constant<bool,
+          views_variant<std::tuple<ViewTypes...>, variant<Types...>>::value &&
+          conjunction<std::is_const<viewed_type_t<ViewTypes>>::value...>::value
+        >
+    {
+    };
+
+    //whether the I-th of Types can view a T, a const T needs a const view
+    template <typename T, size_t I, typename Types>
+    struct views_value
+      : public std::integral_constant<bool,
+          !std::is_const<T>::value ||
+          std::is_const<viewed_type_t<std::tuple_element_t<I, Types>>>::value
+        >
+    {
+    };
+
+    template <typename T, typename Types>
+    struct views_value<T, tuple_not_found, Types> : public std::false_type {};
+
+    //the smallest unsigned type that can hold every index
+    template <size_t N>
+    using view_index_t = std::conditional_t<
+      N <= std::numeric_limits<unsigned char>::max(), unsigned char, size_t>;
+  }
+
+  template <typename... Types>
+  class variant_ref
+  {
+    public:
+
+    template <size_t I>
+    using value_type = detail::viewed_type_t<
+      std::tuple_element_t<I, std::tuple<Types...>>>;
+
+    //views t, which is one of the types, the first that matches if the type
+    //is given more than once
+    template <typename T,
+      size_t I = tuple_find<std::remove_const_t<T>,
+        std::tuple<std::remove_const_t<detail::viewed_type_t<Types>>...>
+      >::value,
+      typename = std::enable_if_t<
+        detail::views_value<T, I, std::tuple<Types...>>::value>
+    >
+    variant_ref(T& t)
+    : m_value(const_cast<void*>(static_cast<const void*>(std::addressof(t))))
+    , m_index(I)
+    {
+    }
+
+    template <typename V,
+      typename = std::enable_if_t<
+        detail::views_variant<std::tuple<Types...>, V>::value>
+    >
+    variant_ref(V& v)
+    : m_value(address(v, std::index_sequence_for<Types...>()))
+    , m_index(v.index())
+    {
+    }
+
+    size_t index() const { return m_index; }
+
+    //the address of the viewed value
+    void* address() const { return m_value; }
+
+    private:
+    template <typename V, size_t... I>
+    static
+    void*
+    address(V& v, std::index_sequence<I...>)
+    {
+      if (v.valueless_by_exception())
+      {
+        detail::raise(bad_variant_access("Can't view a valueless variant"));
+      }
+
+      typedef void* (*addresser)(V&);
+      static constexpr addresser table[] = {&address_at<I, V>...};
+
+      return table[v.index()](v);
+    }
+
+    template <size_t I, typename V>
+    static
+    void*
+    address_at(V& v)
+    {
+      return const_cast<void*>(static_cast<const void*>(
+        std::addressof(juice::get<I>(v))));
+    }
+
+    void* m_value;
+    detail::view_index_t<sizeof...(Types)> m_index;
+  };
+
+  template <size_t I, typename... Types>
+  typename variant_ref<Types...>::template value_type<I>*
+  get_if(variant_ref<Types...> v)
+  {
+    if (v.index() != I)
+    {
+      return nullptr;
+    }
+
+    typedef typename variant_ref<Types...>::template value_type<I> value;
+    return static_cast<value*>(v.address());
+  }
+
+  template <typename T, typename... Types>
+  auto
+  get_if(variant_ref<Types...> v)
+  {
+    return get_if<tuple_find<std::remove_const_t<T>,
+      std::tuple<std::remove_const_t<detail::viewed_type_t<Types>>...>
+    >::value>(v);
+  }
+
+  template <size_t I, typename... Types>
+  typename variant_ref<Types...>::template value_type<I>&
+  get(variant_ref<Types...> v)
+  {
+    auto p = get_if<I>(v);
+    if (p == nullptr)
+    {
+      detail::raise(
+        bad_variant_access("Tuple does not contain requested item"));
+    }
+
+    return *p;
+  }
+
+  template <typename T, typename... Types>
+  auto&
+  get(variant_ref<Types...> v)
+  {
+    auto p = get_if<T>(v);
+    if (p == nullptr)
+    {
+      detail::raise(
+        bad_variant_access("Tuple does not contain requested item"));
+    }
+
+    return *p;
+  }
+
+  namespace detail
+  {
+    template <size_t I, typename Visitor, typename... Types>
+    decltype(auto)
+    visit_ref_at(Visitor&& visitor, variant_ref<Types...> v)
+    {
+      return std::forward<Visitor>(visitor)(
+        *static_cast<typename variant_ref<Types...>::template value_type<I>*>(
+          v.address()));
+    }
+
+    template <typename Visitor, typename... Types, size_t... I>
+    decltype(auto)
+    visit_ref(Visitor&& visitor, variant_ref<Types...> v,
+      std::index_sequence<I...>)
+    {
+      typedef decltype(visit_ref_at<0>(std::forward<Visitor>(visitor), v))
+        result;
+      typedef result (*caller)(Visitor&&, variant_ref<Types...>);
+      static constexpr caller table[] = {
+        &visit_ref_at<I, Visitor, Types...>...
+      };
+
+      return table[v.index()](std::forward<Visitor>(visitor), v);
+    }
+  }
+
+  //calls visitor with the viewed value, every call must return the same type
+  template <typename Visitor, typename... Types>
+  decltype(auto)
+  visit(Visitor&& visitor, variant_ref<Types...> v)
+  {
+    return detail::visit_ref(std::forward<Visitor>(visitor), v,
+      std::index_sequence_for<Types...>());
+  }
+}
+
+#endif
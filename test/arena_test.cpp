@@ -0,0 +1,114 @@
+#include <juice/arena.hpp>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Op;
+
+  typedef juice::variant<int, double, juice::arena_wrapper<Op>> Expr;
+
+  struct Op
+  {
+    char op;
+    Expr left;
+    Expr right;
+  };
+
+  double
+  evaluate(const Expr& e)
+  {
+    if (auto i = juice::get_if<int>(&e))
+    {
+      return *i;
+    }
+    else if (auto d = juice::get_if<double>(&e))
+    {
+      return *d;
+    }
+
+    auto& o = juice::get<Op>(e);
+    double l = evaluate(o.left);
+    double r = evaluate(o.right);
+    return o.op == '+' ? l + r : l * r;
+  }
+}
+
+static_assert(std::is_trivially_destructible<juice::variant<int, char>>::value,
+  "variant of trivial types should be trivially destructible");
+static_assert(!std::is_trivially_destructible<
+    juice::variant<int, std::string>
+  >::value,
+  "variant of a string should be destroyed");
+static_assert(std::is_trivially_destructible<Expr>::value,
+  "arena trees should be trivially destructible");
+
+TEST_CASE("Build a tree in an arena", "[arena]")
+{
+  juice::tree_arena arena(256);
+  juice::tree_arena::scope scope(arena);
+
+  Expr e = Op{'+', 1, Op{'*', 2.5, 4}};
+  REQUIRE(evaluate(e) == 11);
+
+  Expr copy = e;
+  juice::get<Op>(copy).op = '*';
+  REQUIRE(evaluate(copy) == 10);
+  REQUIRE(evaluate(e) == 11);
+
+  for (int i = 0; i != 100; ++i)
+  {
+    Expr next = Op{'+', std::move(e), 1};
+    e = std::move(next);
+  }
+  REQUIRE(evaluate(e) == 111);
+
+  size_t capacity = arena.capacity();
+  REQUIRE(capacity > 256);
+
+  arena.reset();
+  REQUIRE(arena.capacity() == 256);
+}
+
+TEST_CASE("Tear down a deep tree", "[arena]")
+{
+  juice::tree_arena arena;
+  juice::tree_arena::scope scope(arena);
+
+  //nothing recurses when the tree goes, however deep it is
+  Expr e = 0;
+  for (int i = 1; i <= 100000; ++i)
+  {
+    Expr next = Op{'+', std::move(e), 1};
+    e = std::move(next);
+  }
+
+  int depth = 0;
+  for (const Expr* p = &e; p->index() == 2; p = &juice::get<Op>(*p).left)
+  {
+    ++depth;
+  }
+  REQUIRE(depth == 100000);
+}
+
+TEST_CASE("Assign to a moved from arena tree", "[arena]")
+{
+  juice::tree_arena arena;
+  juice::tree_arena::scope scope(arena);
+
+  Expr a = Op{'+', 1, 2};
+  Expr c = Op{'*', 3, 4};
+  Expr b = std::move(a);
+
+  a = c;
+  REQUIRE(evaluate(a) == 12);
+  REQUIRE(evaluate(b) == 3);
+
+  juice::arena_wrapper<int> x(5);
+  juice::arena_wrapper<int> y(std::move(x));
+  REQUIRE(!(x == y));
+  REQUIRE(!(y == x));
+
+  x = 5;
+  REQUIRE(x == y);
+}
@@ -0,0 +1,41 @@
+#include <juice/deferred_destroy.hpp>
+#include <juice/variant.hpp>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node;
+
+  typedef juice::variant<std::shared_ptr<int>, juice::recursive_wrapper<Node>>
+    Tree;
+
+  struct Node
+  {
+    std::vector<Tree> children;
+  };
+}
+
+TEST_CASE("Destroy a tree later", "[deferred_destroy]")
+{
+  std::thread::id destroyed_by;
+  auto leaf = std::shared_ptr<int>(new int(42), [&destroyed_by] (int* i) {
+    destroyed_by = std::this_thread::get_id();
+    delete i;
+  });
+  std::weak_ptr<int> watch = leaf;
+
+  Tree t = Node{{leaf, Node{{std::move(leaf)}}}};
+  REQUIRE(!watch.expired());
+
+  juice::deferred_destroy(std::move(t));
+  juice::reclaimer::instance().drain();
+
+  REQUIRE(watch.expired());
+  REQUIRE(destroyed_by != std::this_thread::get_id());
+}
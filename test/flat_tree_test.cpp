@@ -0,0 +1,132 @@
+#include <juice/flat_tree.hpp>
+
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Apply;
+
+  typedef juice::variant<int, juice::recursive_wrapper<Apply>> Expr;
+
+  struct Apply
+  {
+    char op;
+    std::vector<Expr> args;
+  };
+
+  template <typename F>
+  void
+  for_each_child(const Apply& a, F&& f)
+  {
+    for (auto& arg : a.args)
+    {
+      f(arg);
+    }
+  }
+
+  template <typename F>
+  void
+  for_each_child(Apply& a, F&& f)
+  {
+    for (auto& arg : a.args)
+    {
+      f(arg);
+    }
+  }
+
+  struct Show
+  {
+    std::string
+    operator()(int i) const
+    {
+      return std::to_string(i);
+    }
+
+    std::string
+    operator()(const Apply& a, juice::fold_results<std::string> args) const
+    {
+      std::string s = "(";
+      s += a.op;
+      for (auto& arg : args)
+      {
+        s += " " + arg;
+      }
+      return s + ")";
+    }
+  };
+
+  struct IsApply
+  {
+    bool
+    operator()(int) const
+    {
+      return false;
+    }
+
+    bool
+    operator()(const Apply&) const
+    {
+      return true;
+    }
+  };
+}
+
+TEST_CASE("Flatten a tree", "[flat_tree]")
+{
+  Expr e = Apply{'+', {1, Apply{'*', {2, 3, 4}}, Apply{'+', {}}, 5}};
+  std::string shown = juice::fold(e, Show());
+
+  juice::flat_tree<Expr> flat(e);
+
+  REQUIRE(flat.size() == 8);
+  REQUIRE(flat.index(0) == 1);
+  REQUIRE(flat.subtree_size(0) == 8);
+  REQUIRE(flat.index(1) == 0);
+  REQUIRE(juice::get<int>(flat.value(1)) == 1);
+
+  //children of the root
+  REQUIRE(flat.next_sibling(1) == 2);
+  REQUIRE(flat.subtree_size(2) == 4);
+  REQUIRE(flat.next_sibling(2) == 6);
+  REQUIRE(flat.subtree_size(6) == 1);
+  REQUIRE(flat.next_sibling(6) == 7);
+  REQUIRE(flat.next_sibling(7) == 8);
+
+  REQUIRE(flat.visit(IsApply(), 2));
+  REQUIRE(!flat.visit(IsApply(), 3));
+  REQUIRE(juice::get<Apply>(flat.value(2)).op == '*');
+
+  //the children were moved out of the stored nodes
+  REQUIRE(juice::get<Apply>(flat.value(2)).args.size() == 3);
+  REQUIRE(juice::get<Apply>(flat.value(2)).args[0].valueless_by_exception());
+
+  REQUIRE(flat.fold(Show()) == shown);
+
+  Expr back = flat.unflatten();
+  REQUIRE(juice::fold(back, Show()) == shown);
+}
+
+TEST_CASE("Flatten a leaf", "[flat_tree]")
+{
+  juice::flat_tree<Expr> flat(Expr(42));
+
+  REQUIRE(flat.size() == 1);
+  REQUIRE(flat.fold(Show()) == "42");
+  REQUIRE(juice::get<int>(flat.unflatten()) == 42);
+}
+
+TEST_CASE("Flatten a valueless tree", "[flat_tree]")
+{
+  Expr leaf(7);
+  leaf.extract<0>();
+  REQUIRE_THROWS_AS(juice::flat_tree<Expr>{leaf},
+    const juice::bad_variant_access&);
+
+  Expr e = Apply{'+', {1, 2}};
+  juice::get<Apply>(e).args[1].extract<0>();
+  REQUIRE_THROWS_AS(juice::flat_tree<Expr>{e},
+    const juice::bad_variant_access&);
+}
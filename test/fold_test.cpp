@@ -0,0 +1,134 @@
+#include <juice/fold.hpp>
+
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Apply;
+
+  typedef juice::variant<int, juice::recursive_wrapper<Apply>> Expr;
+
+  struct Apply
+  {
+    char op;
+    std::vector<Expr> args;
+  };
+
+  template <typename F>
+  void
+  for_each_child(const Apply& a, F&& f)
+  {
+    for (auto& arg : a.args)
+    {
+      f(arg);
+    }
+  }
+
+  struct Evaluate
+  {
+    int
+    operator()(int i) const
+    {
+      return i;
+    }
+
+    int
+    operator()(const Apply& a, juice::fold_results<int> args) const
+    {
+      int result = a.op == '+' ? 0 : 1;
+      for (int i : args)
+      {
+        result = a.op == '+' ? result + i : result * i;
+      }
+      return result;
+    }
+  };
+
+  struct Show
+  {
+    std::string
+    operator()(int i) const
+    {
+      return std::to_string(i);
+    }
+
+    std::string
+    operator()(const Apply& a, juice::fold_results<std::string> args) const
+    {
+      std::string s = "(";
+      s += a.op;
+      for (auto& arg : args)
+      {
+        s += " " + arg;
+      }
+      return s + ")";
+    }
+  };
+
+  struct Print
+  {
+    void
+    operator()(int i)
+    {
+      out += std::to_string(i) + " ";
+    }
+
+    void
+    operator()(const Apply& a)
+    {
+      out += a.op;
+      out += " ";
+    }
+
+    std::string out;
+  };
+}
+
+TEST_CASE("Fold a tree", "[fold]")
+{
+  Expr e = Apply{'+', {1, Apply{'*', {2, 3, 4}}, Apply{'+', {}}, 5}};
+
+  REQUIRE(juice::fold(e, Evaluate()) == 30);
+  REQUIRE(juice::fold(Expr(42), Evaluate()) == 42);
+
+  SECTION("Reuse a workspace")
+  {
+    juice::fold_workspace<Expr, int> ws;
+    REQUIRE(juice::fold(e, Evaluate(), ws) == 30);
+    REQUIRE(juice::fold(juice::get<Apply>(e).args[1], Evaluate(), ws) == 24);
+  }
+
+  SECTION("Fold to a string")
+  {
+    REQUIRE(juice::fold(e, Show()) == "(+ 1 (* 2 3 4) (+) 5)");
+  }
+}
+
+TEST_CASE("Fold a deep tree", "[fold]")
+{
+  //destroying the tree still recurses, so it can't be too deep
+  Expr e = 0;
+  for (int i = 1; i <= 5000; ++i)
+  {
+    Apply a{'+', {}};
+    a.args.push_back(std::move(e));
+    a.args.push_back(1);
+
+    Expr next = std::move(a);
+    e = std::move(next);
+  }
+
+  REQUIRE(juice::fold(e, Evaluate()) == 5000);
+}
+
+TEST_CASE("Walk a tree", "[walk]")
+{
+  Expr e = Apply{'+', {1, Apply{'*', {2, 3}}, 4}};
+
+  Print p;
+  juice::walk(e, p);
+  REQUIRE(p.out == "+ 1 * 2 3 4 ");
+}
@@ -0,0 +1,106 @@
+#include <juice/interned.hpp>
+
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Sum;
+
+  typedef juice::variant<int, juice::interned<Sum>> Term;
+
+  struct Sum
+  {
+    Term left;
+    Term right;
+
+    bool
+    operator==(const Sum& rhs) const
+    {
+      return left == rhs.left && right == rhs.right;
+    }
+  };
+
+  struct SumHash
+  {
+    size_t
+    operator()(const Sum& s) const
+    {
+      return std::hash<Term>()(s.left) * 31 + std::hash<Term>()(s.right);
+    }
+  };
+
+  typedef juice::intern_table<Sum, SumHash> SumTable;
+
+  Term
+  sum(SumTable& table, Term left, Term right)
+  {
+    return Term(juice::emplaced_type<juice::interned<Sum>>, table,
+      Sum{left, right});
+  }
+
+  int
+  evaluate(const Term& t)
+  {
+    if (auto i = juice::get_if<int>(&t))
+    {
+      return *i;
+    }
+
+    auto& s = juice::get<Sum>(t);
+    return evaluate(s.left) + evaluate(s.right);
+  }
+}
+
+TEST_CASE("Identical subtrees are shared", "[interned]")
+{
+  SumTable table;
+
+  Term a = sum(table, sum(table, 1, 2), sum(table, 1, 2));
+  Term b = sum(table, sum(table, 1, 2), sum(table, 1, 2));
+  Term c = sum(table, sum(table, 1, 2), 3);
+
+  REQUIRE(table.size() == 3);
+  REQUIRE(juice::get_if<Sum>(&a) == juice::get_if<Sum>(&b));
+  REQUIRE(a.operator==(b));
+  REQUIRE(!a.operator==(c));
+
+  auto& s = juice::get<Sum>(a);
+  REQUIRE(&juice::get<Sum>(s.left) == &juice::get<Sum>(s.right));
+
+  REQUIRE(std::hash<Term>()(a) == std::hash<Term>()(b));
+  REQUIRE(evaluate(a) == 6);
+  REQUIRE(evaluate(c) == 6);
+}
+
+TEST_CASE("Intern from multiple threads", "[interned]")
+{
+  SumTable table;
+  std::vector<const Sum*> roots(4);
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i != roots.size(); ++i)
+  {
+    threads.emplace_back([&table, &roots, i] {
+      Term t = 0;
+      for (int j = 0; j != 100; ++j)
+      {
+        t = sum(table, t, j);
+      }
+      roots[i] = juice::get_if<Sum>(&t);
+    });
+  }
+
+  for (auto& t : threads)
+  {
+    t.join();
+  }
+
+  REQUIRE(table.size() == 100);
+  for (auto root : roots)
+  {
+    REQUIRE(root == roots.front());
+  }
+}
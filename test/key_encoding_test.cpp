@@ -0,0 +1,55 @@
+#include <juice/key_encoding.hpp>
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  typedef juice::variant<int, double, std::string, bool> Key;
+  typedef juice::variant<juice::monostate, long, Key> Nested;
+}
+
+TEST_CASE("Keys sort like the values", "[key_encoding]")
+{
+  std::vector<Key> keys = {
+    0, -1, 1, std::numeric_limits<int>::min(), std::numeric_limits<int>::max(),
+    0.0, -0.0, 1.5, -1.5, -std::numeric_limits<double>::infinity(),
+    std::numeric_limits<double>::infinity(), 1e-300, -1e300,
+    std::string(), std::string("a"), std::string("ab"), std::string("b"),
+    std::string("a\0", 2), std::string("a\0b", 3), std::string("\xff"),
+    false, true
+  };
+
+  for (const auto& k : keys)
+  {
+    std::string encoded = juice::encode_key(k);
+    REQUIRE(juice::decode_key<Key>(encoded) == k);
+
+    for (const auto& l : keys)
+    {
+      std::string other = juice::encode_key(l);
+      REQUIRE((encoded < other) == (k < l));
+      REQUIRE((encoded == other) == (k == l));
+    }
+  }
+
+  Nested n(Key(std::string("nested")));
+  REQUIRE(juice::decode_key<Nested>(juice::encode_key(n)) == n);
+  REQUIRE(juice::encode_key(Nested()) < juice::encode_key(Nested(-5L)));
+}
+
+TEST_CASE("Decode a bad key", "[key_encoding]")
+{
+  std::string key = juice::encode_key(Key(std::string("key")));
+
+  REQUIRE_THROWS_AS(juice::decode_key<Key>(key.substr(0, key.size() - 1)),
+    const juice::bad_key&);
+  REQUIRE_THROWS_AS(juice::decode_key<Key>(key + "x"), const juice::bad_key&);
+  REQUIRE_THROWS_AS(juice::decode_key<Key>(std::string("\x09")),
+    const juice::bad_key&);
+  REQUIRE_THROWS_AS(juice::decode_key<Key>(std::string()),
+    const juice::bad_key&);
+}
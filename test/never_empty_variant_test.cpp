@@ -0,0 +1,173 @@
+#include <juice/never_empty_variant.hpp>
+
+#include <functional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Throws
+  {
+    Throws() = default;
+
+    Throws(const Throws&)
+    {
+      throw std::runtime_error("copy");
+    }
+
+    Throws&
+    operator=(const Throws&) = default;
+
+    bool
+    operator==(const Throws&) const
+    {
+      return true;
+    }
+  };
+
+  //can't be made from an int, but moves without throwing
+  struct Refuses
+  {
+    explicit
+    Refuses(int)
+    {
+      throw std::runtime_error("refused");
+    }
+
+    bool
+    operator==(const Refuses&) const
+    {
+      return true;
+    }
+  };
+
+  struct Pair;
+
+  typedef juice::never_empty_variant<int, juice::recursive_wrapper<Pair>>
+    Tree;
+
+  struct Pair
+  {
+    Tree first;
+    Tree second;
+
+    bool
+    operator==(const Pair& rhs) const
+    {
+      return first == rhs.first && second == rhs.second;
+    }
+  };
+
+  struct Describe
+  {
+    std::string
+    operator()(int i) const
+    {
+      return std::to_string(i);
+    }
+
+    std::string
+    operator()(const std::string& s) const
+    {
+      return s;
+    }
+
+    std::string
+    operator()(const Throws&) const
+    {
+      return "throws";
+    }
+  };
+}
+
+TEST_CASE("Never empty", "[never_empty]")
+{
+  typedef juice::never_empty_variant<int, std::string, Throws> V;
+
+  V v("hello");
+  REQUIRE(v.index() == 1);
+  REQUIRE(juice::get<std::string>(v) == "hello");
+  REQUIRE(juice::visit(Describe(), v) == "hello");
+
+  V thrower(juice::emplaced_type<Throws>);
+  REQUIRE_THROWS_AS(v = thrower, const std::runtime_error&);
+  REQUIRE(v.index() == 1);
+  REQUIRE(juice::get<std::string>(v) == "hello");
+
+  v = 5;
+  REQUIRE(juice::get<int>(v) == 5);
+  REQUIRE(juice::get_if<std::string>(&v) == nullptr);
+
+  V w(v);
+  REQUIRE(w.operator==(v));
+  v.emplace<std::string>(3, 'a');
+  swap(v, w);
+  REQUIRE(juice::visit(Describe(), v) == "5");
+  REQUIRE(juice::visit(Describe(), w) == "aaa");
+
+  w.emplace_with<int>([] { return 7; });
+  REQUIRE(juice::get<int>(w) == 7);
+}
+
+TEST_CASE("Assign a subtree of a never empty tree", "[never_empty]")
+{
+  Tree t = Pair{Pair{1, 2}, 3};
+  t = Tree(juice::get<Pair>(t).first);
+  REQUIRE(t.operator==(Tree(Pair{1, 2})));
+
+  t = juice::get<Pair>(t).second;
+  REQUIRE(juice::get<int>(t) == 2);
+}
+
+TEST_CASE("Never empty with one buffer", "[never_empty]")
+{
+  typedef juice::never_empty_variant<int, std::string, Refuses> V;
+
+  static_assert(sizeof(V) < sizeof(
+      juice::never_empty_variant<int, std::string, Throws>),
+    "a variant whose moves can't throw has one buffer");
+  static_assert(noexcept(std::declval<V&>().swap(std::declval<V&>())),
+    "swapping moves, which can't throw");
+  static_assert(!noexcept(swap(
+      std::declval<juice::never_empty_variant<int, Throws>&>(),
+      std::declval<juice::never_empty_variant<int, Throws>&>())),
+    "swapping moves, which copies a Throws");
+
+  V v("hello");
+  REQUIRE_THROWS_AS(v.emplace<Refuses>(1), const std::runtime_error&);
+  REQUIRE(juice::get<std::string>(v) == "hello");
+
+  v = 5;
+  REQUIRE(juice::get<int>(v) == 5);
+  v.emplace<std::string>(2, 'b');
+  REQUIRE(juice::get<std::string>(v) == "bb");
+}
+
+TEST_CASE("Compare and hash never empty variants", "[never_empty]")
+{
+  typedef juice::never_empty_variant<int, std::string> V;
+
+  V a(2);
+  V b(3);
+  V c("a");
+
+  REQUIRE(a < b);
+  REQUIRE(b < c);
+  REQUIRE(a <= a);
+  REQUIRE(c > a);
+  REQUIRE(c >= b);
+  REQUIRE(a != b);
+  REQUIRE(juice::compare(c, V("a")) == 0);
+  REQUIRE(juice::compare(V("b"), c) > 0);
+
+  typedef juice::variant<int, std::string> Plain;
+
+  std::hash<V> hash;
+  std::hash<Plain> plain_hash;
+  REQUIRE(hash(a) == hash(V(2)));
+  REQUIRE(hash(a) == plain_hash(Plain(2)));
+  REQUIRE(hash(c) == plain_hash(Plain("a")));
+}
@@ -0,0 +1,146 @@
+// Built with -fno-exceptions and JUICE_NO_EXCEPTIONS, which Catch does not
+// support, so the checks are plain asserts.
+
+#undef NDEBUG
+
+#include <juice/never_empty_variant.hpp>
+#include <juice/relocate.hpp>
+#include <juice/variant_cast.hpp>
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+  typedef juice::variant<int, std::string> Named;
+
+  const int handled = 42;
+
+  void
+  exit_handler(const char* what)
+  {
+    std::_Exit(std::strcmp(what, "bad_variant_cast") == 0 ? handled : 1);
+  }
+
+  //runs f in a child process and returns its exit code
+  template <typename F>
+  int
+  exit_code(F f)
+  {
+    pid_t child = fork();
+    if (child == 0)
+    {
+      f();
+      std::_Exit(0);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+  }
+
+  void
+  test_access()
+  {
+    Named n(5);
+    assert(juice::get<int>(n) == 5);
+
+    auto i = juice::try_get<int>(n);
+    assert(i.has_value() && *i == 5);
+
+    auto s = juice::try_get<std::string>(n);
+    assert(!s);
+    assert(s.value_or("none") == "none");
+
+    const Named& c = n;
+    assert(juice::try_get<0>(c).value() == 5);
+
+    juice::variant<int, char> number(5);
+    auto narrowed = juice::try_variant_cast<juice::variant<int>>(number);
+    assert(narrowed && juice::get<int>(*narrowed) == 5);
+    number = 'c';
+    assert(!juice::try_variant_cast<juice::variant<int>>(number));
+
+    juice::never_empty_variant<int, std::string> ne("hello");
+    assert(juice::get<std::string>(ne) == "hello");
+  }
+
+  void
+  test_errors()
+  {
+    //the default handler aborts
+    assert(exit_code([] {
+      Named n(5);
+      juice::get<std::string>(n);
+    }) == -1);
+
+    juice::error_handler previous = juice::set_error_handler(&exit_handler);
+    assert(previous != nullptr);
+
+    assert(exit_code([] {
+      juice::variant<int, char> v('c');
+      juice::variant_cast<juice::variant<int>>(v);
+    }) == handled);
+
+    juice::set_error_handler(previous);
+  }
+
+  //the cleanup is never run, and an else after it belongs to the if
+  //around it
+  int
+  guarded(bool run)
+  {
+    int result = 0;
+    if (run)
+      JUICE_TRY
+      {
+        result = 1;
+      }
+      JUICE_CATCH_ALL
+      {
+        result = 2;
+      }
+    else
+      result = 3;
+
+    return result;
+  }
+
+  void
+  test_macros()
+  {
+    assert(guarded(true) == 1);
+    assert(guarded(false) == 3);
+  }
+
+  void
+  test_relocate()
+  {
+    typename std::aligned_storage<sizeof(Named) * 2, alignof(Named)>::type
+      storage;
+    Named* from = reinterpret_cast<Named*>(&storage);
+    new (from) Named("a string that is too long for the buffer");
+
+    Named* to = juice::uninitialized_relocate(from, from + 1, from + 1) - 1;
+    assert(juice::get<std::string>(*to) ==
+      "a string that is too long for the buffer");
+    to->~Named();
+  }
+}
+
+int
+main()
+{
+  test_access();
+  test_errors();
+  test_macros();
+  test_relocate();
+
+  std::printf("no exceptions: all tests passed\n");
+  return 0;
+}
@@ -0,0 +1,114 @@
+#include <juice/offset_wrapper.hpp>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Op;
+
+  typedef juice::variant<int, juice::offset_wrapper<Op>> Expr;
+
+  struct Op
+  {
+    char op;
+    Expr left;
+    Expr right;
+  };
+
+  int
+  evaluate(const Expr& e)
+  {
+    if (auto i = juice::get_if<int>(&e))
+    {
+      return *i;
+    }
+
+    auto& o = juice::get<Op>(e);
+    int l = evaluate(o.left);
+    int r = evaluate(o.right);
+    return o.op == '+' ? l + r : l * r;
+  }
+}
+
+TEST_CASE("Offset wrapper is an offset", "[offset_wrapper]")
+{
+  REQUIRE(sizeof(juice::offset_wrapper<Op>) == 4);
+}
+
+TEST_CASE("Build and copy an offset tree", "[offset_wrapper]")
+{
+  std::unique_ptr<std::max_align_t[]> image;
+  size_t image_size = 0;
+  juice::offset_arena::offset_type root = 0;
+
+  {
+    juice::offset_arena arena(1024);
+    juice::offset_arena::scope scope(arena);
+
+    root = arena.construct<Expr>(Op{'+', 1, Op{'*', 2, 3}});
+    auto& e = arena.at<Expr>(root);
+    REQUIRE(evaluate(e) == 7);
+
+    Expr copy = e;
+    juice::get<Op>(copy).op = '*';
+    REQUIRE(evaluate(copy) == 6);
+    REQUIRE(evaluate(e) == 7);
+
+    image_size = arena.size();
+    image.reset(
+      new std::max_align_t[image_size / sizeof(std::max_align_t) + 1]);
+    std::memcpy(image.get(), arena.data(), image_size);
+  }
+
+  SECTION("Use the memory in place")
+  {
+    juice::offset_arena loaded(image.get(), image_size, image_size);
+    juice::offset_arena::scope scope(loaded);
+
+    REQUIRE(evaluate(loaded.at<Expr>(root)) == 7);
+  }
+
+  SECTION("Copy into an arena")
+  {
+    juice::offset_arena loaded(1024);
+    loaded.assign(image.get(), image_size);
+    juice::offset_arena::scope scope(loaded);
+
+    auto& e = loaded.at<Expr>(root);
+    REQUIRE(evaluate(e) == 7);
+
+    e = Op{'*', 3, 4};
+    REQUIRE(evaluate(e) == 12);
+  }
+}
+
+TEST_CASE("Offset arena is bounded", "[offset_wrapper]")
+{
+  juice::offset_arena arena(sizeof(Op));
+  juice::offset_arena::scope scope(arena);
+
+  REQUIRE_THROWS_AS(arena.construct<Expr>(Op{'+', Op{'+', 1, 2}, 3}),
+    const std::bad_alloc&);
+}
+
+TEST_CASE("Assign to a moved from offset tree", "[offset_wrapper]")
+{
+  juice::offset_arena arena(1024);
+  juice::offset_arena::scope scope(arena);
+
+  Expr a = Op{'+', 1, 2};
+  Expr c = Op{'*', 3, 4};
+  Expr b = std::move(a);
+
+  a = c;
+  REQUIRE(evaluate(a) == 12);
+  REQUIRE(evaluate(b) == 3);
+
+  juice::offset_wrapper<int> x(5);
+  juice::offset_wrapper<int> y(std::move(x));
+  REQUIRE(!(x == y));
+  REQUIRE(!(y == x));
+
+  x = 5;
+  REQUIRE(x == y);
+}
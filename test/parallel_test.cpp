@@ -0,0 +1,122 @@
+#include <juice/parallel.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node;
+}
+
+namespace juice
+{
+  template <>
+  struct node_cloner<Node> : public parallel_cloner<Node> {};
+}
+
+namespace
+{
+  typedef juice::variant<int, juice::recursive_wrapper<Node>> Tree;
+
+  struct Node
+  {
+    std::vector<Tree> children;
+
+    bool
+    operator==(const Node& rhs) const
+    {
+      return children == rhs.children;
+    }
+  };
+
+  template <typename F>
+  void
+  for_each_child(const Node& n, F&& f)
+  {
+    for (auto& c : n.children)
+    {
+      f(c);
+    }
+  }
+
+  struct Sum
+  {
+    long
+    operator()(int i) const
+    {
+      return i;
+    }
+
+    long
+    operator()(const Node&, juice::fold_results<long> children) const
+    {
+      long total = 0;
+      for (auto c : children)
+      {
+        total += c;
+      }
+      return total;
+    }
+  };
+
+  Tree
+  build(int depth, int& next)
+  {
+    if (depth == 0)
+    {
+      return next++;
+    }
+
+    Node n;
+    for (int i = 0; i != 3; ++i)
+    {
+      n.children.push_back(build(depth - 1, next));
+    }
+    return n;
+  }
+}
+
+TEST_CASE("Task groups", "[parallel]")
+{
+  juice::task_pool pool(4);
+  std::atomic<int> count(0);
+
+  juice::task_group group(pool);
+  for (int i = 0; i != 100; ++i)
+  {
+    group.run([&pool, &count] {
+      juice::task_group inner(pool);
+      for (int j = 0; j != 10; ++j)
+      {
+        inner.run([&count] { ++count; });
+      }
+      inner.wait();
+    });
+  }
+  group.wait();
+
+  REQUIRE(count == 1000);
+
+  group.run([] { throw std::runtime_error("task"); });
+  REQUIRE_THROWS_AS(group.wait(), const std::runtime_error&);
+}
+
+TEST_CASE("Parallel fold and copy", "[parallel]")
+{
+  juice::task_pool pool(4);
+  int next = 0;
+  Tree t = build(8, next);
+
+  long expected = juice::fold(t, Sum());
+  REQUIRE(expected == long(next) * (next - 1) / 2);
+  REQUIRE(juice::parallel_fold(t, Sum(), pool, 16) == expected);
+  REQUIRE(juice::parallel_fold(Tree(5), Sum(), pool, 16) == 5);
+
+  Tree copy = juice::parallel_copy(t, pool, 16);
+  REQUIRE(copy.operator==(t));
+  REQUIRE(&juice::get<Node>(copy) != &juice::get<Node>(t));
+  REQUIRE(juice::fold(copy, Sum()) == expected);
+}
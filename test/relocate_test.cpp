@@ -0,0 +1,69 @@
+#include <juice/variant.hpp>
+
+#include <memory>
+#include <string>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node;
+
+  typedef juice::variant<int, std::unique_ptr<int>,
+    juice::recursive_wrapper<Node>> Movable;
+
+  struct Node
+  {
+    Movable child;
+  };
+
+  typedef juice::variant<int, std::string> Named;
+
+  static_assert(juice::is_trivially_relocatable<Movable>::value,
+    "pointers and wrappers can be relocated with memcpy");
+  static_assert(!juice::is_trivially_relocatable<Named>::value,
+    "std::string may point into itself");
+
+  template <typename T>
+  struct buffer
+  {
+    T*
+    get()
+    {
+      return reinterpret_cast<T*>(&storage);
+    }
+
+    typename std::aligned_storage<sizeof(T) * 3, alignof(T)>::type storage;
+  };
+}
+
+TEST_CASE("Relocate variants", "[relocate]")
+{
+  buffer<Movable> from;
+  buffer<Movable> to;
+
+  new (from.get()) Movable(5);
+  new (from.get() + 1) Movable(std::unique_ptr<int>(new int(6)));
+  new (from.get() + 2) Movable(Node{7});
+
+  auto end = juice::uninitialized_relocate(from.get(), from.get() + 3,
+    to.get());
+  REQUIRE(end == to.get() + 3);
+
+  Movable* m = to.get();
+  REQUIRE(juice::get<int>(m[0]) == 5);
+  REQUIRE(*juice::get<std::unique_ptr<int>>(m[1]) == 6);
+  REQUIRE(juice::get<int>(juice::get<Node>(m[2]).child) == 7);
+
+  buffer<Named> named;
+  new (named.get()) Named(std::string("a long string that is on the heap"));
+  Named* moved = juice::relocate(named.get(), named.get() + 1);
+  REQUIRE(juice::get<std::string>(*moved) ==
+    "a long string that is on the heap");
+
+  moved->~Named();
+  for (int i = 0; i != 3; ++i)
+  {
+    m[i].~Movable();
+  }
+}
@@ -0,0 +1,110 @@
+#include <juice/sort.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <type_traits>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  typedef juice::variant<int, double, long> Numbers;
+  typedef juice::variant<long, std::string> Keys;
+
+  static_assert(juice::is_trivially_relocatable<Numbers>::value,
+    "sorting Numbers relocates them");
+  static_assert(!juice::is_trivially_relocatable<Keys>::value &&
+    std::is_nothrow_move_constructible<Keys>::value,
+    "sorting Keys moves them");
+
+  //a move that might throw, so that partitioning uses std::stable_sort
+  struct Name
+  {
+    Name(std::string n)
+    : name(std::move(n))
+    {
+    }
+
+    Name(const Name&) = default;
+    Name(Name&& rhs) : name(std::move(rhs.name)) {}
+    Name& operator=(const Name&) = default;
+    Name& operator=(Name&&) = default;
+
+    std::string name;
+  };
+
+  bool
+  operator<(const Name& a, const Name& b)
+  {
+    return a.name < b.name;
+  }
+
+  typedef juice::variant<long, Name> Names;
+
+  template <typename Range>
+  bool
+  sorted(const Range& range)
+  {
+    return std::is_sorted(range.begin(), range.end());
+  }
+}
+
+TEST_CASE("Sort variants", "[sort]")
+{
+  std::mt19937 random(7);
+  std::vector<Numbers> numbers;
+  for (int i = 0; i != 1000; ++i)
+  {
+    int r = static_cast<int>(random() % 100);
+    switch (random() % 3)
+    {
+      case 0:
+      numbers.push_back(r);
+      break;
+      case 1:
+      numbers.push_back(r * 0.5);
+      break;
+      default:
+      numbers.push_back(static_cast<long>(r));
+      break;
+    }
+  }
+
+  std::vector<Numbers> expected = numbers;
+  std::sort(expected.begin(), expected.end());
+
+  std::vector<Numbers> sorted_numbers = numbers;
+  juice::sort(sorted_numbers);
+  REQUIRE(sorted_numbers == expected);
+
+  std::deque<Numbers> in_parallel(numbers.begin(), numbers.end());
+  juice::parallel_sort(in_parallel);
+  REQUIRE(std::equal(in_parallel.begin(), in_parallel.end(),
+    expected.begin()));
+
+  std::vector<Keys> keys;
+  for (int i = 0; i != 100; ++i)
+  {
+    int r = static_cast<int>(random() % 50);
+    keys.push_back(i % 2 == 0 ? Keys(static_cast<long>(r)) :
+      Keys("key " + std::to_string(r)));
+  }
+  juice::sort(keys);
+  REQUIRE(sorted(keys));
+  REQUIRE(keys.front().index() == 0);
+  REQUIRE(keys.back().index() == 1);
+
+  std::vector<Names> names;
+  for (int i = 0; i != 100; ++i)
+  {
+    names.push_back(i % 2 == 0 ? Names(static_cast<long>(99 - i)) :
+      Names(Name("name " + std::to_string(i))));
+  }
+  juice::sort(names);
+  REQUIRE(sorted(names));
+  REQUIRE(juice::get<long>(names.front()) == 1);
+  REQUIRE(juice::get<Name>(names.back()).name == "name 99");
+}
@@ -0,0 +1,101 @@
+#include <juice/stable_hash.hpp>
+
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node;
+
+  typedef juice::variant<std::int64_t, std::string, double,
+    juice::recursive_wrapper<Node>> Value;
+
+  struct Node
+  {
+    std::vector<Value> children;
+  };
+
+  struct Point
+  {
+    int x;
+    int y;
+  };
+
+  typedef juice::variant<int, Point> Shape;
+  typedef juice::variant<std::string, Point, int> Reordered;
+}
+
+namespace juice
+{
+  template <>
+  struct stable_hasher<Node>
+  {
+    void
+    operator()(stable_hash_state& state, const Node& n) const
+    {
+      stable_hasher<std::vector<Value>>()(state, n.children);
+    }
+  };
+
+  template <>
+  struct stable_hasher<Point>
+  {
+    void
+    operator()(stable_hash_state& state, const Point& p) const
+    {
+      state.add(p.x);
+      state.add(p.y);
+    }
+  };
+
+  template <>
+  struct type_name<Point>
+  {
+    static constexpr const char* value = "Point";
+  };
+
+  template <>
+  struct type_name<int>
+  {
+    static constexpr const char* value = "int";
+  };
+}
+
+TEST_CASE("FNV-1a", "[stable_hash]")
+{
+  //the published test vectors
+  static_assert(juice::detail::fnv1a("") == 0xcbf29ce484222325, "empty");
+  static_assert(juice::detail::fnv1a("a") == 0xaf63dc4c8601ec8c, "a");
+  static_assert(juice::detail::fnv1a("foobar") == 0x85944171f73967e8,
+    "foobar");
+
+  juice::stable_hash_state state;
+  state.add_bytes("foobar", 6);
+  REQUIRE(state.value() == 0x85944171f73967e8);
+}
+
+TEST_CASE("Pinned hashes", "[stable_hash]")
+{
+  //these must never change, hashes are stored and compared between builds
+  REQUIRE(juice::stable_hash(Value(std::int64_t(42))) == 0x9d44c7352c418dcf);
+  REQUIRE(juice::stable_hash(Value(std::int64_t(-1))) == 0x821e65573beff6dd);
+  REQUIRE(juice::stable_hash(Value(std::string("key"))) ==
+    0xa22de5031b9b13de);
+  REQUIRE(juice::stable_hash(Value(1.5)) == 0x25ca904986e3fffe);
+  REQUIRE(juice::stable_hash(Value(Node{{Value(std::int64_t(1)),
+    Value(std::string("a"))}})) == 0x9e36a0f4ce8a0f0c);
+}
+
+TEST_CASE("Equal values hash the same", "[stable_hash]")
+{
+  REQUIRE(juice::stable_hash(Value(0.0)) == juice::stable_hash(Value(-0.0)));
+  REQUIRE(juice::stable_hash(Value(std::int64_t(1))) !=
+    juice::stable_hash(Value(1.0)));
+
+  //named types keep their hash when the alternatives move
+  REQUIRE(juice::stable_hash(Shape(Point{1, 2})) ==
+    juice::stable_hash(Reordered(Point{1, 2})));
+  REQUIRE(juice::stable_hash(Shape(3)) == juice::stable_hash(Reordered(3)));
+}
@@ -0,0 +1,72 @@
+#include <juice/std_variant.hpp>
+#include <juice/variant_hash.hpp>
+
+#include <string>
+#include <string_view>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node
+  {
+    int value;
+  };
+
+  typedef juice::variant<int, std::string> Named;
+  typedef juice::variant<int, juice::recursive_wrapper<Node>> Tree;
+
+  static_assert(juice::is_std_compatible_v<Named, std::variant<int,
+    std::string>>, "the same alternatives match");
+  static_assert(juice::is_std_compatible_v<Tree, std::variant<int, Node>>,
+    "a recursive_wrapper matches the type it holds");
+  static_assert(!juice::is_std_compatible_v<Named, std::variant<std::string,
+    int>>, "the order must match");
+}
+
+TEST_CASE("Convert to std::variant", "[std_variant]")
+{
+  Named n(std::string("a string that is too long for the buffer"));
+  const char* buffer = juice::get<std::string>(n).data();
+
+  std::variant<int, std::string> s = juice::to_std(std::move(n));
+  REQUIRE(s.index() == 1);
+  REQUIRE(std::get<1>(s).data() == buffer);
+
+  Named back = juice::from_std<Named>(std::move(s));
+  REQUIRE(juice::get<std::string>(back).data() == buffer);
+
+  REQUIRE(back == std::string_view("a string that is too long for the buffer"));
+  REQUIRE(back > std::string_view("a"));
+
+  Named i(5);
+  REQUIRE(std::get<int>(juice::to_std(i)) == 5);
+  REQUIRE(juice::get<int>(i) == 5);
+}
+
+TEST_CASE("Convert a recursive_wrapper", "[std_variant]")
+{
+  Tree t = Node{4};
+  const Node* node = &juice::get<Node>(t);
+
+  juice::std_variant_t<Tree> wrapped = juice::to_std(std::move(t));
+  REQUIRE(&std::get<1>(wrapped).get() == node);
+
+  Tree back = juice::from_std<Tree>(std::move(wrapped));
+  auto unwrapped = juice::to_std<std::variant<int, Node>>(back);
+  REQUIRE(std::get<Node>(unwrapped).value == 4);
+
+  Tree again = juice::from_std<Tree>(unwrapped);
+  REQUIRE(juice::get<Node>(again).value == 4);
+}
+
+TEST_CASE("Hash a std::string_view", "[std_variant]")
+{
+  juice::variant_hash<Named> hash;
+  juice::variant_equal<Named> equal;
+
+  Named n(std::string("a string that is too long for the buffer"));
+  std::string_view view = "a string that is too long for the buffer";
+  REQUIRE(hash(view) == hash(n));
+  REQUIRE(equal(n, view));
+}
@@ -0,0 +1,67 @@
+#include <juice/variant_cast.hpp>
+
+#include <string>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node
+  {
+    int value;
+  };
+
+  typedef juice::variant<int, std::string> Small;
+  typedef juice::variant<double, int, std::string, char> Large;
+
+  typedef juice::variant<int, juice::recursive_wrapper<Node>> Tree;
+  typedef juice::variant<std::string, juice::recursive_wrapper<Node>, int>
+    Wider;
+
+  static_assert(juice::is_widening_cast_v<Large, Small>,
+    "every type of Small is in Large");
+  static_assert(!juice::is_widening_cast_v<Small, Large>,
+    "Large has types that Small doesn't");
+}
+
+TEST_CASE("Widen a variant", "[variant_cast]")
+{
+  Small s(std::string("a string that is too long for the buffer"));
+  Large l = juice::variant_cast<Large>(s);
+  REQUIRE(l.index() == 2);
+  REQUIRE(juice::get<std::string>(l) ==
+    "a string that is too long for the buffer");
+
+  l = juice::variant_cast<Large>(std::move(s));
+  REQUIRE(juice::get<std::string>(s).empty());
+
+  Small i(5);
+  REQUIRE(juice::get<int>(juice::variant_cast<Large>(i)) == 5);
+
+  Tree t = Node{4};
+  const Node* node = &juice::get<Node>(t);
+  Wider w = juice::variant_cast<Wider>(std::move(t));
+  REQUIRE(w.index() == 1);
+  REQUIRE(&juice::get<Node>(w) == node);
+}
+
+TEST_CASE("Narrow a variant", "[variant_cast]")
+{
+  Large l(5);
+  REQUIRE(juice::variant_castable<Small>(l));
+  REQUIRE(juice::get<int>(juice::variant_cast<Small>(l)) == 5);
+
+  l = 'c';
+  REQUIRE(!juice::variant_castable<Small>(l));
+  REQUIRE_THROWS_AS(juice::variant_cast<Small>(l),
+    const juice::bad_variant_cast&);
+
+  auto failed = juice::try_variant_cast<Small>(l);
+  REQUIRE(!failed.has_value());
+  REQUIRE(juice::get<int>(failed.value_or(7)) == 7);
+
+  l = std::string("narrowed");
+  auto narrowed = juice::try_variant_cast<Small>(std::move(l));
+  REQUIRE(narrowed);
+  REQUIRE(juice::get<std::string>(*narrowed) == "narrowed");
+}
@@ -0,0 +1,111 @@
+#include <juice/variant_hash_map.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+namespace
+{
+  typedef juice::variant<std::int64_t, std::string> Key;
+  typedef juice::variant<std::int64_t, double> Number;
+
+  static_assert(juice::is_trivially_relocatable<
+    std::pair<const Number, int>>::value, "stored in the slots");
+}
+
+TEST_CASE("Insert and find", "[variant_hash_map]")
+{
+  juice::variant_hash_map<Key, int> map;
+  REQUIRE(map.empty());
+  REQUIRE(map.find("missing") == map.end());
+
+  for (std::int64_t i = 0; i != 1000; ++i)
+  {
+    map[Key(i)] = static_cast<int>(i);
+    map[Key("key " + std::to_string(i))] = static_cast<int>(-i);
+  }
+  REQUIRE(map.size() == 2000);
+
+  REQUIRE(map.find(std::int64_t(500))->second == 500);
+  REQUIRE(map.find("key 500")->second == -500);
+  REQUIRE(map.find(std::string("key 999"))->second == -999);
+  REQUIRE(map.count(Key(std::int64_t(1000))) == 0);
+  REQUIRE(!map.contains("key 1000"));
+
+  REQUIRE(!map.try_emplace(Key(std::int64_t(1)), 5).second);
+  REQUIRE(map[Key(std::int64_t(1))] == 1);
+
+  size_t visited = 0;
+  for (const auto& e : map)
+  {
+    REQUIRE(juice::holds_alternative<std::int64_t>(e.first) ==
+      (e.second >= 0 && e.first != Key("key 0")));
+    ++visited;
+  }
+  REQUIRE(visited == 2000);
+}
+
+TEST_CASE("Erase", "[variant_hash_map]")
+{
+  juice::variant_hash_map<Number, int> map;
+  for (std::int64_t i = 0; i != 100; ++i)
+  {
+    map.try_emplace(Number(i), 1);
+    map.try_emplace(Number(i + 0.5), 2);
+  }
+
+  for (std::int64_t i = 0; i != 100; i += 2)
+  {
+    REQUIRE(map.erase(Number(i)) == 1);
+  }
+  REQUIRE(map.erase(Number(std::int64_t(0))) == 0);
+  REQUIRE(map.size() == 150);
+  REQUIRE(!map.contains(Number(std::int64_t(2))));
+  REQUIRE(map.contains(Number(std::int64_t(3))));
+  REQUIRE(map.contains(Number(2.5)));
+
+  auto copy = map;
+  map.clear();
+  REQUIRE(map.empty());
+  REQUIRE(copy.size() == 150);
+  REQUIRE(copy.find(Number(3.5))->second == 2);
+}
+
+TEST_CASE("Grow with entries that are moved", "[variant_hash_map]")
+{
+  static_assert(!juice::is_trivially_relocatable<
+    std::pair<const Key, std::vector<int>>>::value, "moved when growing");
+
+  juice::variant_hash_map<Key, std::vector<int>> map;
+  std::string prefix = "a key that is too long to be stored in place ";
+  for (int i = 0; i != 500; ++i)
+  {
+    map[Key(prefix + std::to_string(i))] = std::vector<int>(3, i);
+  }
+
+  REQUIRE(map.size() == 500);
+  for (int i = 0; i != 500; ++i)
+  {
+    auto it = map.find(prefix + std::to_string(i));
+    REQUIRE(it != map.end());
+    REQUIRE(it->second == std::vector<int>(3, i));
+  }
+}
+
+TEST_CASE("Valueless keys", "[variant_hash_map]")
+{
+  juice::variant_hash_map<Key, int> map;
+  map[Key("named")] = 1;
+
+  Key valueless(std::string("named"));
+  valueless.extract<1>();
+  REQUIRE(valueless.valueless_by_exception());
+
+  REQUIRE(map.find(valueless) == map.end());
+  REQUIRE_THROWS_AS(map[valueless], const juice::bad_variant_access&);
+  REQUIRE_THROWS_AS(map.try_emplace(std::move(valueless), 2),
+    const juice::bad_variant_access&);
+  REQUIRE(map.size() == 1);
+}
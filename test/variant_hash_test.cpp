@@ -0,0 +1,44 @@
+#include <juice/variant_hash.hpp>
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+#include "catch.hpp"
+
+namespace
+{
+  typedef juice::variant<std::int64_t, std::string> Key;
+  typedef juice::variant_hash<Key> KeyHash;
+  typedef juice::variant_equal<Key> KeyEqual;
+
+  static_assert(std::is_same<KeyHash::is_transparent, void>::value,
+    "the hash is transparent");
+}
+
+TEST_CASE("Hash an alternative", "[variant_hash]")
+{
+  KeyHash hash;
+  REQUIRE(hash(Key(std::int64_t(5))) == std::hash<Key>()(Key(std::int64_t(5))));
+  REQUIRE(hash(std::int64_t(5)) == hash(Key(std::int64_t(5))));
+  REQUIRE(hash(std::string("key")) == hash(Key("key")));
+  REQUIRE(hash("key") == hash(Key("key")));
+  REQUIRE(hash(std::int64_t(5)) != hash(std::int64_t(6)));
+
+  juice::variant_hash<Key, juice::mix_hasher> mixed;
+  REQUIRE(mixed(std::int64_t(5)) == mixed(Key(std::int64_t(5))));
+}
+
+TEST_CASE("Compare with an alternative", "[variant_hash]")
+{
+  KeyEqual equal;
+  REQUIRE(equal(Key("key"), Key("key")));
+  REQUIRE(equal(Key("key"), "key"));
+  REQUIRE(equal("key", Key("key")));
+  REQUIRE(!equal(Key(std::int64_t(1)), "key"));
+  REQUIRE(equal(Key(std::int64_t(1)), std::int64_t(1)));
+
+  std::unordered_set<Key, KeyHash, KeyEqual> keys;
+  keys.insert(Key("key"));
+  REQUIRE(keys.count(Key("key")) == 1);
+}
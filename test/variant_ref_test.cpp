@@ -0,0 +1,86 @@
+#include <juice/variant_ref.hpp>
+
+#include <string>
+
+#include "catch.hpp"
+
+namespace
+{
+  struct Node
+  {
+    int value;
+  };
+
+  typedef juice::variant<int, std::string, juice::recursive_wrapper<Node>>
+    Value;
+  typedef juice::variant_ref<int, std::string, Node> ValueRef;
+  typedef juice::variant_ref<const int, const std::string, const Node>
+    ConstValueRef;
+
+  static_assert(std::is_trivially_copyable<ValueRef>::value,
+    "a view is copied by value");
+  static_assert(sizeof(ValueRef) == 2 * sizeof(void*),
+    "a view is a pointer and an index");
+  static_assert(!std::is_constructible<ValueRef, const Value&>::value,
+    "a const variant needs a const view");
+
+  struct Describe
+  {
+    std::string
+    operator()(int i) const
+    {
+      return std::to_string(i);
+    }
+
+    std::string
+    operator()(const std::string& s) const
+    {
+      return s;
+    }
+
+    std::string
+    operator()(const Node& n) const
+    {
+      return "node " + std::to_string(n.value);
+    }
+  };
+
+  std::string
+  describe(ConstValueRef v)
+  {
+    return juice::visit(Describe(), v);
+  }
+}
+
+TEST_CASE("View a variant", "[variant_ref]")
+{
+  Value v(std::string("hello"));
+  ValueRef r = v;
+  REQUIRE(r.index() == 1);
+  REQUIRE(&juice::get<std::string>(r) == &juice::get<std::string>(v));
+
+  juice::get<1>(r) += " world";
+  REQUIRE(juice::get<std::string>(v) == "hello world");
+  REQUIRE(juice::get_if<int>(r) == nullptr);
+  REQUIRE_THROWS_AS(juice::get<0>(r), const juice::bad_variant_access&);
+
+  const Value node = Node{3};
+  REQUIRE(describe(node) == "node 3");
+  REQUIRE(&juice::get<Node>(ConstValueRef(node)) == &juice::get<Node>(node));
+}
+
+TEST_CASE("View a value", "[variant_ref]")
+{
+  int i = 5;
+  REQUIRE(describe(i) == "5");
+
+  ValueRef r = i;
+  *juice::get_if<0>(r) = 6;
+  REQUIRE(i == 6);
+
+  char c = 'a';
+  juice::variant<int, char&> refs(c);
+  juice::variant_ref<int, char&> view = refs;
+  juice::get<char>(view) = 'b';
+  REQUIRE(c == 'b');
+}
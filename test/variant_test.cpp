@@ -1,5 +1,8 @@
 #include <juice/variant.hpp>
 
+#include <memory>
+#include <string>
+
 #include "catch.hpp"
 #include "test_facilities.hpp"
 
@@ -61,6 +64,20 @@ TEST_CASE("Get correct type", "[get]")
   }
 }
 
+TEST_CASE("Try get", "[get]")
+{
+  typedef juice::variant<int, std::string> MyVariant;
+
+  MyVariant v(5);
+  REQUIRE(juice::try_get<int>(v).has_value());
+  REQUIRE(*juice::try_get<0>(v) == 5);
+
+  auto s = juice::try_get<std::string>(v);
+  REQUIRE(!s);
+  REQUIRE(s.value_or("empty") == "empty");
+  REQUIRE_THROWS_AS(s.value(), const juice::bad_variant_access&);
+}
+
 TEST_CASE("Comparison", "[compare]") {
   typedef juice::variant<int, std::string> MyVariant;
 
@@ -75,4 +92,303 @@ TEST_CASE("Comparison", "[compare]") {
   REQUIRE(b > a);
   REQUIRE(c > a);
   REQUIRE(b == d);
+
+  REQUIRE(a <= b);
+  REQUIRE(b <= d);
+  REQUIRE(!(b <= a));
+  REQUIRE(b >= d);
+  REQUIRE(!(a >= b));
+
+  REQUIRE(juice::compare(a, b) < 0);
+  REQUIRE(juice::compare(c, a) > 0);
+  REQUIRE(juice::compare(b, d) == 0);
+  REQUIRE(juice::compare(c, MyVariant("Hello world")) == 0);
+
+  MyVariant empty(4);
+  empty.extract<int>();
+  REQUIRE(juice::compare(empty, a) < 0);
+  REQUIRE(empty < c);
+  REQUIRE(juice::compare(empty, empty) == 0);
+}
+
+namespace
+{
+  //a compare member that isn't an ordering
+  struct Version
+  {
+    int number;
+
+    bool
+    compare(const Version& rhs) const
+    {
+      return number == rhs.number;
+    }
+  };
+
+  bool
+  operator<(const Version& a, const Version& b)
+  {
+    return a.number < b.number;
+  }
+}
+
+TEST_CASE("Compare with operator< unless compare is marked", "[compare]")
+{
+  typedef juice::variant<int, Version> Versioned;
+
+  static_assert(juice::has_three_way_compare<std::string>::value,
+    "strings are compared with compare");
+  static_assert(!juice::has_three_way_compare<Version>::value,
+    "Version is compared with operator<");
+
+  REQUIRE(Versioned(Version{1}) < Versioned(Version{2}));
+  REQUIRE(!(Versioned(Version{2}) < Versioned(Version{1})));
+  REQUIRE(juice::compare(Versioned(Version{2}), Versioned(Version{1})) > 0);
+  REQUIRE(juice::compare(Versioned(Version{3}), Versioned(Version{3})) == 0);
+}
+
+TEST_CASE("Swap", "[swap]")
+{
+  typedef juice::variant<int, std::string> Named;
+
+  Named a(4);
+  Named b("a string long enough to be on the heap");
+
+  swap(a, b);
+  REQUIRE(juice::get<std::string>(a) ==
+    "a string long enough to be on the heap");
+  REQUIRE(juice::get<int>(b) == 4);
+
+  Named c("short");
+  a.swap(c);
+  REQUIRE(juice::get<std::string>(a) == "short");
+  REQUIRE(juice::get<std::string>(c) ==
+    "a string long enough to be on the heap");
+
+  typedef juice::variant<int, std::unique_ptr<int>> Owner;
+  static_assert(noexcept(std::declval<Owner&>().swap(std::declval<Owner&>())),
+    "a relocatable variant is swapped bytewise");
+
+  Owner d(1);
+  Owner e(std::unique_ptr<int>(new int(2)));
+  swap(d, e);
+  REQUIRE(*juice::get<std::unique_ptr<int>>(d) == 2);
+  REQUIRE(juice::get<int>(e) == 1);
+}
+
+namespace
+{
+  struct Pair;
+
+  typedef juice::variant<int, juice::recursive_wrapper<Pair>> Tree;
+
+  struct Pair
+  {
+    Tree first;
+    Tree second;
+  };
+}
+
+TEST_CASE("Assign a subtree", "[assign]")
+{
+  Tree t = Pair{1, Pair{2, 3}};
+
+  //the value being assigned is destroyed along with the tree
+  t = juice::get<Pair>(t).first;
+  REQUIRE(juice::get<int>(t) == 1);
+
+  //and the same for a value that is converted
+  t = Pair{Pair{4, 5}, 6};
+  t = juice::get<int>(juice::get<Pair>(t).second);
+  REQUIRE(juice::get<int>(t) == 6);
+}
+
+TEST_CASE("Assign to a moved from tree", "[assign]")
+{
+  Tree t = Pair{1, 2};
+  Tree u = std::move(t);
+
+  t = Pair{3, 4};
+  REQUIRE(juice::get<int>(juice::get<Pair>(t).second) == 4);
+  REQUIRE(juice::get<int>(juice::get<Pair>(u).first) == 1);
+}
+
+namespace
+{
+  struct Message
+  {
+    explicit
+    Message(int id)
+    : id(id)
+    {
+    }
+
+    Message(Message&& rhs)
+    : id(rhs.id)
+    {
+      ++moves;
+    }
+
+    int id;
+
+    static int moves;
+  };
+
+  int Message::moves = 0;
+
+  Message
+  decode(int id)
+  {
+    return Message(id);
+  }
+}
+
+TEST_CASE("Emplace from a factory", "[emplace]")
+{
+  typedef juice::variant<int, Message> Frame;
+
+  Frame f(juice::emplaced_with<1>, [] { return decode(1); });
+  REQUIRE(juice::get<Message>(f).id == 1);
+
+  f.emplace_with<Message>([] { return decode(2); });
+  REQUIRE(juice::get<Message>(f).id == 2);
+  REQUIRE(Message::moves == 0);
+}
+
+TEST_CASE("Extract a value", "[extract]")
+{
+  typedef juice::variant<int, std::unique_ptr<int>> Owner;
+
+  Owner o(std::unique_ptr<int>(new int(3)));
+  std::unique_ptr<int> p = o.extract<std::unique_ptr<int>>();
+  REQUIRE(*p == 3);
+  REQUIRE(o.valueless_by_exception());
+  REQUIRE_THROWS_AS(o.extract<0>(), const juice::bad_variant_access&);
+
+  //a valueless variant can be copied
+  typedef juice::variant<int, std::string> Named;
+  Named n(std::string("named"));
+  n.extract<1>();
+  Named copy(n);
+  REQUIRE(copy.valueless_by_exception());
+  copy = Named(4);
+  copy = n;
+  REQUIRE(copy.valueless_by_exception());
+
+  o.emplace<1>(std::move(p));
+  std::aligned_storage_t<sizeof(p), alignof(std::unique_ptr<int>)> storage;
+  std::unique_ptr<int>* moved = o.extract_to<1>(&storage);
+  REQUIRE(**moved == 3);
+  REQUIRE(o.valueless_by_exception());
+  moved->~unique_ptr();
+}
+
+TEST_CASE("Compare with a value", "[compare]")
+{
+  typedef juice::variant<int, std::string> MyVariant;
+
+  MyVariant a(4);
+  MyVariant s("Hello world");
+
+  REQUIRE(a == 4);
+  REQUIRE(4 == a);
+  REQUIRE(a != 5);
+  REQUIRE(a != "Hello world");
+  REQUIRE(s == "Hello world");
+  REQUIRE(s != std::string("Hello"));
+
+  REQUIRE(a < 5);
+  REQUIRE(3 < a);
+  REQUIRE(a <= 4);
+  REQUIRE(a >= 4);
+  REQUIRE(a < "Hello world");
+  REQUIRE(s > 100);
+  REQUIRE(s < "Hi");
+  REQUIRE("Hi" > s);
+  REQUIRE(juice::compare(s, "Hello world") == 0);
+  REQUIRE(juice::compare(a, 5) < 0);
+}
+
+TEST_CASE("Hash", "[hash]")
+{
+  typedef juice::variant<int, long, std::string> Key;
+
+  const std::hash<Key> hash{};
+  REQUIRE(hash(Key(5)) == hash(Key(5)));
+  REQUIRE(hash(Key(5)) != hash(Key(5L)));
+  REQUIRE(hash(Key("key")) == hash(Key(std::string("key"))));
+
+  juice::basic_variant_hash<juice::mix_hasher> mixed;
+  REQUIRE(mixed(Key(5)) == mixed(Key(5)));
+  REQUIRE(mixed(Key(5)) != mixed(Key(6)));
+  REQUIRE(mixed(Key("key")) == hash(Key("key")));
+}
+
+namespace
+{
+  struct Config;
+}
+
+namespace juice
+{
+  template <>
+  struct is_hash_cached<Config> : public std::true_type {};
+}
+
+namespace
+{
+  typedef juice::variant<int, juice::recursive_wrapper<Config>> Setting;
+
+  struct Config
+  {
+    Setting left;
+    Setting right;
+  };
+
+  bool
+  operator==(const Config& a, const Config& b)
+  {
+    return a.left == b.left && a.right == b.right;
+  }
+
+  int config_hashes = 0;
+}
+
+namespace std
+{
+  template <>
+  struct hash<Config>
+  {
+    size_t
+    operator()(const Config& c) const
+    {
+      ++config_hashes;
+      return hash<Setting>()(c.left) * 31 + hash<Setting>()(c.right);
+    }
+  };
+}
+
+TEST_CASE("Cached hash", "[hash]")
+{
+  Setting s = Config{Config{1, 2}, 3};
+  const Setting& cs = s;
+  const std::hash<Setting> hash{};
+
+  size_t first = hash(cs);
+  REQUIRE(config_hashes == 2);
+  REQUIRE(hash(cs) == first);
+  REQUIRE(config_hashes == 2);
+
+  //the copy keeps the hashes, and unequal hashes are unequal trees
+  Setting copy = s;
+  REQUIRE(copy == s);
+  juice::get<int>(juice::get<Config>(copy).right) = 4;
+  size_t changed = hash(copy);
+  REQUIRE(changed != first);
+  REQUIRE(config_hashes == 3);
+  REQUIRE(!(copy == s));
+
+  juice::get<int>(juice::get<Config>(copy).right) = 3;
+  REQUIRE(hash(copy) == first);
+  REQUIRE(copy == s);
 }